@@ -0,0 +1,128 @@
+#include <array>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include "../parser.cpp"
+#include "../message_columns.h"
+#include "../platform.h"
+#include "../ladder/inline_ladder_orderbook.cpp"
+
+// runs the same analytics passes over message_stream_ (one 32 byte struct per message) and over
+// MessageColumns, best of REPS runs each, and reports time and the rate of bytes the pass actually needs.
+// then replays the columns row by row into a book and checks it ends where the row replay does
+
+static constexpr int REPS = 5;
+
+template<typename Fn>
+static uint64_t best_of(Fn&& fn, uint64_t& result) {
+    uint64_t best = UINT64_MAX;
+    for (int rep = 0; rep < REPS; ++rep) {
+        platform::Stopwatch timer;
+        result = fn();
+        best = std::min(best, timer.elapsed_ns());
+    }
+    return best;
+}
+
+template<typename RowFn, typename ColumnFn>
+static void compare(const char* name, size_t messages, size_t column_bytes, RowFn&& row_pass, ColumnFn&& column_pass) {
+    uint64_t row_result = 0, column_result = 0;
+    uint64_t row_ns = best_of(row_pass, row_result);
+    uint64_t column_ns = best_of(column_pass, column_result);
+    std::cout << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(2)
+              << std::setw(10) << row_ns / 1e6 << std::setw(10) << column_ns / 1e6
+              << std::setw(12) << static_cast<double>(messages * column_bytes) / column_ns
+              << std::setw(8) << (row_result == column_result ? "yes" : "NO") << "\n";
+    std::cout.unsetf(std::ios::fixed);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " <input_file>\n";
+        return 1;
+    }
+
+    try {
+        Parser parser(argv[1]);
+        parser.parse();
+        const auto& rows = parser.message_stream_;
+
+        MessageColumns parsed_columns;
+        Parser(argv[1]).parse_into(parsed_columns);
+        MessageColumns columns{MessageSpan(rows)};
+        bool same_fill = parsed_columns.time_ == columns.time_ && parsed_columns.id_ == columns.id_
+                         && parsed_columns.price_ == columns.price_ && parsed_columns.action_ == columns.action_;
+        std::cout << rows.size() << " messages, parser fill matches conversion: " << (same_fill ? "yes" : "NO") << "\n";
+
+        const int32_t mid = rows.empty() ? 0 : rows[rows.size() / 2].price_;
+        std::cout << std::left << std::setw(24) << "pass" << std::right << std::setw(10) << "rows ms"
+                  << std::setw(10) << "cols ms" << std::setw(12) << "cols GB/s" << std::setw(8) << "same" << "\n";
+
+        compare("count 'A'", rows.size(), sizeof(char), [&] {
+            uint64_t count = 0;
+            for (const auto& msg : rows) count += msg.action_ == 'A';
+            return count;
+        }, [&] { return columns::count_action(columns, 'A'); });
+
+        compare("action histogram", rows.size(), sizeof(char), [&] {
+            std::array<uint64_t, 256> histogram{};
+            for (const auto& msg : rows) ++histogram[static_cast<uint8_t>(msg.action_)];
+            return histogram['A'] * 3 + histogram['C'] * 5 + histogram['M'] * 7;
+        }, [&] {
+            auto histogram = columns::action_histogram(columns);
+            return histogram['A'] * 3 + histogram['C'] * 5 + histogram['M'] * 7;
+        });
+
+        compare("'C' per second", rows.size(), sizeof(uint64_t) + sizeof(char), [&] {
+            std::vector<uint32_t> per_second;
+            const uint64_t start = rows.empty() ? 0 : rows[0].time_ / 1000000000ULL * 1000000000ULL;
+            for (const auto& msg : rows) {
+                uint64_t second = msg.time_ < start ? 0 : (msg.time_ - start) / 1000000000ULL;
+                if (per_second.size() <= second) per_second.resize(second + 1, 0);
+                per_second[second] += msg.action_ == 'C';
+            }
+            uint64_t checksum = 0;
+            for (size_t i = 0; i < per_second.size(); ++i) checksum += per_second[i] * (i + 1);
+            return checksum;
+        }, [&] {
+            auto per_second = columns::action_per_second(columns, 'C');
+            uint64_t checksum = 0;
+            for (size_t i = 0; i < per_second.size(); ++i) checksum += per_second[i] * (i + 1);
+            return checksum;
+        });
+
+        compare("price within 100 of mid", rows.size(), sizeof(int32_t), [&] {
+            uint64_t count = 0;
+            for (const auto& msg : rows) count += msg.price_ >= mid - 100 && msg.price_ <= mid + 100;
+            return count;
+        }, [&] { return columns::count_in_price_range(columns, mid - 100, mid + 100); });
+
+        compare("added size", rows.size(), sizeof(uint32_t) + sizeof(char), [&] {
+            uint64_t total = 0;
+            for (const auto& msg : rows) total += msg.action_ == 'A' ? msg.size_ : 0;
+            return total;
+        }, [&] { return columns::sum_size_for_action(columns, 'A'); });
+
+        auto* row_book = new InlineLadder_Orderbook();
+        auto* column_book = new InlineLadder_Orderbook();
+        platform::Stopwatch timer;
+        for (const auto& msg : rows) row_book->process_msg(msg);
+        uint64_t row_ns = timer.elapsed_ns();
+        timer.reset();
+        columns.for_each_row([column_book](const MessageColumns::Row& msg) { column_book->process_msg(msg); });
+        uint64_t column_ns = timer.elapsed_ns();
+        bool same_book = row_book->get_count() == column_book->get_count()
+                         && row_book->get_best_bid_price() == column_book->get_best_bid_price()
+                         && row_book->get_best_ask_price() == column_book->get_best_ask_price();
+        std::cout << "ladder_inline replay: rows " << row_ns / 1000000 << "ms, columns " << column_ns / 1000000
+                  << "ms, same book: " << (same_book ? "yes" : "NO") << "\n";
+        delete row_book;
+        delete column_book;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,142 @@
+#include <cstdint>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../parser.cpp"
+#include "../message_file.h"
+#include "../compressed_file.h"
+#include "../platform.h"
+#include "../ladder/inline_ladder_orderbook.cpp"
+
+// writes the csv out as a binary message file and as a block compressed one, checks the compressed file
+// decodes back to exactly the parsed messages, then times replay into a book from each of the three with
+// the file dropped from the page cache first (cold) and again with it cached (warm). the drop is
+// posix_fadvise(DONTNEED), which only evicts clean pages but doesn't need root
+
+static void evict(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) return;
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+struct Result {
+    uint64_t ns_ = 0;
+    size_t messages_ = 0;
+    uint64_t count_ = 0;
+    int32_t best_bid_ = 0;
+    int32_t best_ask_ = 0;
+};
+
+template<typename Replay>
+static Result run(const std::string& path, bool cold, Replay&& replay) {
+    if (cold) evict(path);
+    auto* book = new InlineLadder_Orderbook();
+    Result result;
+    platform::Stopwatch timer;
+    result.messages_ = replay(*book);
+    result.ns_ = timer.elapsed_ns();
+    result.count_ = book->get_count();
+    result.best_bid_ = book->get_best_bid_price();
+    result.best_ask_ = book->get_best_ask_price();
+    delete book;
+    return result;
+}
+
+static void print(const char* name, const std::string& path, const Result& cold, const Result& warm, const Result& expected) {
+    const auto bytes = std::filesystem::file_size(path);
+    bool same = cold.count_ == expected.count_ && cold.best_bid_ == expected.best_bid_
+                && cold.best_ask_ == expected.best_ask_ && cold.messages_ == expected.messages_;
+    std::cout << std::left << std::setw(12) << name << std::right << std::fixed << std::setprecision(2)
+              << std::setw(12) << bytes / 1e6 << std::setw(12) << static_cast<double>(bytes) / cold.messages_
+              << std::setw(10) << cold.ns_ / 1e6 << std::setw(10) << warm.ns_ / 1e6
+              << std::setw(8) << (same ? "yes" : "NO") << "\n";
+    std::cout.unsetf(std::ios::fixed);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 2 && argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " <input_csv> [work_dir]\n";
+        return 1;
+    }
+
+    const std::string csv = argv[1];
+    const std::filesystem::path work_dir = argc == 3 ? argv[2] : std::filesystem::temp_directory_path();
+    const std::string stem = std::filesystem::path(csv).stem().string();
+    const std::string bin = (work_dir / (stem + ".bin")).string();
+    const std::string compressed = (work_dir / (stem + ".blk")).string();
+
+    try {
+        Parser parser(csv);
+        parser.parse();
+        const auto& stream = parser.message_stream_;
+        write_message_file(bin, MessageSpan(stream), stem);
+        write_compressed_file(compressed, MessageSpan(stream), stem);
+
+        size_t mismatches = 0;
+        {
+            CompressedMessageFile file(compressed);
+            size_t i = 0;
+            file.for_each([&](const message& msg) {
+                const message& expected = stream[i++];
+                mismatches += msg.id_ != expected.id_ || msg.time_ != expected.time_ || msg.size_ != expected.size_
+                              || msg.price_ != expected.price_ || msg.action_ != expected.action_
+                              || msg.side_ != expected.side_;
+            });
+            mismatches += i != stream.size();
+            std::cout << stream.size() << " messages, " << file.block_count() << " blocks, tick "
+                      << file.header().tick_ << ", decode mismatches: " << mismatches << "\n";
+        }
+
+        auto replay_csv = [&csv](InlineLadder_Orderbook& book) {
+            Parser csv_parser(csv);
+            csv_parser.parse();
+            for (const auto& msg : csv_parser.message_stream_) book.process_msg(msg);
+            return csv_parser.get_message_count();
+        };
+        auto replay_bin = [&bin](InlineLadder_Orderbook& book) {
+            MessageFile file(bin);
+            for (const auto& msg : file.messages()) book.process_msg(msg);
+            return file.messages().size();
+        };
+        auto replay_compressed = [&compressed](InlineLadder_Orderbook& book) {
+            CompressedMessageFile file(compressed);
+            return file.for_each([&book](const message& msg) { book.process_msg(msg); });
+        };
+
+        std::cout << std::left << std::setw(12) << "format" << std::right << std::setw(12) << "MB"
+                  << std::setw(12) << "bytes/msg" << std::setw(10) << "cold ms" << std::setw(10) << "warm ms"
+                  << std::setw(8) << "same" << "\n";
+
+        Result expected = run(csv, false, replay_csv);
+        print("csv", csv, run(csv, true, replay_csv), run(csv, false, replay_csv), expected);
+        print("binary", bin, run(bin, true, replay_bin), run(bin, false, replay_bin), expected);
+        print("compressed", compressed, run(compressed, true, replay_compressed),
+              run(compressed, false, replay_compressed), expected);
+
+        // replay from the middle of the file through the block index
+        CompressedMessageFile file(compressed);
+        if (file.block_count()) {
+            const uint64_t mid_time = stream[stream.size() / 2].time_;
+            const size_t block = file.find_block(mid_time);
+            uint64_t first_time = 0;
+            size_t replayed = file.for_each([&first_time](const message& msg) {
+                if (!first_time) first_time = msg.time_;
+            }, block);
+            std::cout << "seek to " << mid_time << ": block " << block << ", first time " << first_time
+                      << ", " << replayed << " messages to the end\n";
+        }
+
+        std::filesystem::remove(bin);
+        std::filesystem::remove(compressed);
+        return mismatches == 0 ? 0 : 1;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,149 @@
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+#include "../parser.cpp"
+#include "../feature_engine.h"
+#include "../platform.h"
+#include "../vector/orderbook.cpp"
+#include "../map/map_orderbook.cpp"
+
+// replays a file into vector and map books through FeatureEngine, sampling after every message and on a
+// 1ms and a 100ms exchange time grid, and bare for comparison. each replay goes into a fresh book, bare and
+// engine replays take turns RUNS times and each keeps its best, so both see the same cache and frequency
+// state and the overhead isn't one cold run against another. reports bare and engine ns/msg, overhead,
+// samples taken, heap allocations the engine added to the replay (counted by the operator new below, the
+// map book allocates tree nodes for new levels itself, so it's the difference to the bare replay, and has
+// to be 0) and whether both books produced the same samples
+
+static uint64_t allocations = 0;
+
+void* operator new(size_t size) {
+    ++allocations;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+static constexpr size_t RUNS = 5;
+
+using VectorBook = Vector_Orderbook<OpenAddressTable>;
+using MapBook = Orderbook<OpenAddressTable>;
+
+struct Run {
+    uint64_t ns_ = 0;
+    uint64_t allocations_ = 0;
+    uint64_t taken_ = 0;
+    // the ones still in the engine's history
+    std::vector<FeatureSample> samples_;
+};
+
+template<typename Book>
+static Run bare_once(const std::vector<message>& stream) {
+    auto* book = new Book();
+    Run run;
+    const uint64_t before = allocations;
+    platform::Stopwatch timer;
+    for (const auto& msg : stream) book->process_msg(msg);
+    run.ns_ = timer.elapsed_ns();
+    run.allocations_ = allocations - before;
+    delete book;
+    return run;
+}
+
+template<typename Book>
+static Run features_once(const std::vector<message>& stream, uint64_t interval_ns) {
+    auto* book = new Book();
+    FeatureOptions options;
+    options.sample_interval_ns = interval_ns;
+    FeatureEngine<Book> engine(*book, options);
+
+    Run run;
+    const uint64_t before = allocations;
+    platform::Stopwatch timer;
+    for (const auto& msg : stream) engine.process_msg(msg);
+    run.ns_ = timer.elapsed_ns();
+    run.allocations_ = allocations - before;
+
+    const auto& samples = engine.samples();
+    run.taken_ = samples.pushed();
+    run.samples_.reserve(samples.size());
+    for (size_t i = 0; i < samples.size(); ++i) run.samples_.push_back(samples[i]);
+    delete book;
+    return run;
+}
+
+struct Comparison {
+    Run bare_;
+    Run features_;
+};
+
+// alternates bare and engine replays and keeps the fastest of each
+template<typename Book>
+static Comparison compare(const std::vector<message>& stream, uint64_t interval_ns) {
+    Comparison best{bare_once<Book>(stream), features_once<Book>(stream, interval_ns)};
+    for (size_t i = 1; i < RUNS; ++i) {
+        Run bare = bare_once<Book>(stream);
+        if (bare.ns_ < best.bare_.ns_) best.bare_ = std::move(bare);
+        Run features = features_once<Book>(stream, interval_ns);
+        if (features.ns_ < best.features_.ns_) best.features_ = std::move(features);
+    }
+    return best;
+}
+
+static bool same_samples(const std::vector<FeatureSample>& a, const std::vector<FeatureSample>& b) {
+    return a.size() == b.size()
+           && std::equal(a.begin(), a.end(), b.begin(), [](const FeatureSample& x, const FeatureSample& y) {
+               return std::memcmp(&x, &y, sizeof(FeatureSample)) == 0;
+           });
+}
+
+static void report(const char* name, const char* sampling, size_t messages, const Run& run, const Run& bare) {
+    std::cout << std::left << std::setw(8) << name << std::setw(10) << sampling << std::right << std::fixed
+              << std::setprecision(1) << std::setw(10) << static_cast<double>(bare.ns_) / messages
+              << std::setw(10) << static_cast<double>(run.ns_) / messages
+              << std::setw(11) << (static_cast<double>(run.ns_) / bare.ns_ - 1.0) * 100 << "%"
+              << std::setw(10) << run.taken_
+              << std::setw(8) << static_cast<int64_t>(run.allocations_ - bare.allocations_);
+    std::cout.unsetf(std::ios::fixed);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " <input_file>\n";
+        return 1;
+    }
+
+    try {
+        Parser parser(argv[1]);
+        parser.parse();
+        const auto& stream = parser.message_stream_;
+
+        std::cout << stream.size() << " messages, best of " << RUNS << " alternating bare and engine replays\n";
+        std::cout << std::left << std::setw(8) << "book" << std::setw(10) << "sampling" << std::right
+                  << std::setw(10) << "bare" << std::setw(10) << "ns/msg" << std::setw(12) << "overhead"
+                  << std::setw(10) << "samples" << std::setw(8) << "allocs" << std::setw(8) << "same" << "\n";
+
+        const std::pair<const char*, uint64_t> samplings[] = {{"every msg", 0}, {"1ms", 1000000}, {"100ms", 100000000}};
+        for (const auto& [sampling, interval_ns] : samplings) {
+            Comparison vector_run = compare<VectorBook>(stream, interval_ns);
+            Comparison map_run = compare<MapBook>(stream, interval_ns);
+            const bool same = same_samples(vector_run.features_.samples_, map_run.features_.samples_);
+            report("vector", sampling, stream.size(), vector_run.features_, vector_run.bare_);
+            std::cout << std::setw(8) << (same ? "yes" : "NO") << "\n";
+            report("map", sampling, stream.size(), map_run.features_, map_run.bare_);
+            std::cout << std::setw(8) << (same ? "yes" : "NO") << "\n";
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,185 @@
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "../parser.cpp"
+#include "../lookup_table.h"
+#include "../swiss_table.h"
+#include "../direct_index_table.h"
+#include "../vector/order.h"
+
+using namespace std::chrono;
+
+// replays the order id stream of a file through both order tables with every hash policy, the same
+// insert/erase/find pattern the books do, and reports replay time plus the probe length distribution
+// (robin hood: slots from home, swiss: extra groups visited) sampled every SAMPLE_INTERVAL messages.
+// then replays a synthetic mostly increasing id stream through DirectIndexTable with and without a few
+// stray ids far ahead of the rest, to check the strays don't push the rest of the stream into the fallback
+
+static constexpr size_t SAMPLE_INTERVAL = 65536;
+
+struct ProbeStats {
+    std::vector<size_t> histogram_;
+
+    void add(const std::vector<size_t>& sample) {
+        if (sample.size() > histogram_.size()) histogram_.resize(sample.size(), 0);
+        for (size_t i = 0; i < sample.size(); ++i) histogram_[i] += sample[i];
+    }
+
+    size_t total() const {
+        size_t n = 0;
+        for (size_t count : histogram_) n += count;
+        return n;
+    }
+
+    double mean() const {
+        size_t n = total();
+        double sum = 0;
+        for (size_t i = 0; i < histogram_.size(); ++i) sum += static_cast<double>(i) * histogram_[i];
+        return n ? sum / n : 0.0;
+    }
+
+    size_t percentile(double p) const {
+        size_t n = total();
+        size_t seen = 0;
+        for (size_t i = 0; i < histogram_.size(); ++i) {
+            seen += histogram_[i];
+            if (static_cast<double>(seen) >= p * n) return i;
+        }
+        return histogram_.empty() ? 0 : histogram_.size() - 1;
+    }
+
+    double fraction_at_home() const {
+        size_t n = total();
+        return n && !histogram_.empty() ? static_cast<double>(histogram_[0]) / n : 0.0;
+    }
+};
+
+template<typename Table>
+void replay(const std::vector<message>& stream, const std::string& name) {
+    Table table;
+    table.reserve(1000000);
+    Order dummy;
+    ProbeStats stats;
+    nanoseconds elapsed{0};
+
+    for (size_t start = 0; start < stream.size(); start += SAMPLE_INTERVAL) {
+        size_t end = std::min(stream.size(), start + SAMPLE_INTERVAL);
+
+        auto t0 = high_resolution_clock::now();
+        for (size_t i = start; i < end; ++i) {
+            const auto& msg = stream[i];
+            switch (msg.action_) {
+                case 'A':
+                    table.insert(msg.id_, &dummy);
+                    break;
+                case 'C':
+                    if (table.find(msg.id_)) table.erase(msg.id_);
+                    break;
+                case 'M':
+                    if (!table.find(msg.id_)) table.insert(msg.id_, &dummy);
+                    break;
+            }
+        }
+        elapsed += duration_cast<nanoseconds>(high_resolution_clock::now() - t0);
+
+        stats.add(table.probe_histogram());
+    }
+
+    std::cout << std::left << std::setw(28) << name << std::right
+              << std::setw(10) << duration_cast<milliseconds>(elapsed).count()
+              << std::fixed << std::setprecision(3)
+              << std::setw(10) << stats.mean()
+              << std::setw(10) << stats.fraction_at_home()
+              << std::setw(8) << stats.percentile(0.5)
+              << std::setw(8) << stats.percentile(0.99)
+              << std::setw(8) << stats.percentile(1.0) << "\n";
+    std::cout.unsetf(std::ios::fixed);
+}
+
+// adds with increasing ids from 1,000,000 and cancels of random live ones, about LIVE_ORDERS resting.
+// with strays, one add in every STRAY_INTERVAL gets an id around 1e12 instead
+static constexpr size_t SYNTHETIC_MESSAGES = 8000000;
+static constexpr size_t LIVE_ORDERS = 100000;
+static constexpr size_t STRAY_INTERVAL = 500000;
+
+static std::vector<message> synthetic_stream(bool strays) {
+    std::mt19937_64 rng(7);
+    std::vector<message> stream;
+    std::vector<uint64_t> live;
+    stream.reserve(SYNTHETIC_MESSAGES);
+    uint64_t next_id = 1000000;
+    for (size_t i = 0; i < SYNTHETIC_MESSAGES; ++i) {
+        if (live.size() < LIVE_ORDERS || rng() % 2) {
+            const uint64_t id = strays && i % STRAY_INTERVAL == STRAY_INTERVAL / 2 ? 1000000000000ULL + i : next_id++;
+            live.push_back(id);
+            stream.emplace_back(id, i, 1, 100, 'A', true);
+        } else {
+            const size_t pick = rng() % live.size();
+            stream.emplace_back(live[pick], i, 1, 100, 'C', true);
+            live[pick] = live.back();
+            live.pop_back();
+        }
+    }
+    return stream;
+}
+
+static void replay_direct(const std::vector<message>& stream, const std::string& name) {
+    DirectIndexTable<Order> table;
+    Order dummy;
+    size_t peak_fallback = 0;
+    auto t0 = high_resolution_clock::now();
+    for (size_t i = 0; i < stream.size(); ++i) {
+        const auto& msg = stream[i];
+        if (msg.action_ == 'A') table.insert(msg.id_, &dummy);
+        else if (table.find(msg.id_)) table.erase(msg.id_);
+        if (i % SAMPLE_INTERVAL == 0) peak_fallback = std::max(peak_fallback, table.fallback_size());
+    }
+    auto elapsed = duration_cast<milliseconds>(high_resolution_clock::now() - t0);
+    std::cout << std::left << std::setw(28) << name << std::right << std::setw(10) << elapsed.count()
+              << std::setw(14) << peak_fallback << std::setw(10) << table.fallback_size() << "\n";
+}
+
+template<typename Hash>
+void replay_policy(const std::vector<message>& stream, const std::string& name) {
+    replay<BasicOpenAddressTable<Order, Hash>>(stream, "robin_hood/" + name);
+    replay<BasicSwissTable<Order, Hash>>(stream, "swiss/" + name);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " <input_file>\n";
+        return 1;
+    }
+
+    try {
+        Parser parser(argv[1]);
+        parser.parse();
+        const auto& stream = parser.message_stream_;
+
+        std::cout << std::left << std::setw(28) << "table/hash" << std::right << std::setw(10) << "ms"
+                  << std::setw(10) << "mean" << std::setw(10) << "at home" << std::setw(8) << "p50"
+                  << std::setw(8) << "p99" << std::setw(8) << "max" << "\n";
+
+        replay_policy<XXHash>(stream, "xxhash");
+        replay_policy<MurmurHash>(stream, "murmur");
+        replay_policy<FxHash>(stream, "fxhash");
+        replay_policy<WyHash>(stream, "wyhash");
+        replay_policy<FibonacciHash>(stream, "fibonacci");
+        replay<BasicOpenAddressTable<Order, IdentityHash>>(stream, "robin_hood/identity");
+        replay<DirectIndexTable<Order>>(stream, "direct");
+
+        std::cout << "\n" << std::left << std::setw(28) << "synthetic ids" << std::right << std::setw(10) << "ms"
+                  << std::setw(14) << "peak fallback" << std::setw(10) << "fallback" << "\n";
+        replay_direct(synthetic_stream(false), "direct/increasing");
+        replay_direct(synthetic_stream(true), "direct/with strays");
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,78 @@
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "../parser.cpp"
+#include "../ladder/ladder_orderbook.cpp"
+#include "../ladder/inline_ladder_orderbook.cpp"
+
+using namespace std::chrono;
+
+// replays a file through the ladder book with order* tables (order pool + table of pointers) and with
+// orders stored inline in the table, and reports replay time and how much the book grew peak rss by.
+// each variant runs in a forked child after the file is parsed, so the message stream isn't counted
+
+static long peak_rss_kb() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+template<typename Book>
+static void run(const char* name, const std::vector<message>& stream) {
+    std::cout.flush();
+    pid_t pid = fork();
+    if (pid != 0) {
+        waitpid(pid, nullptr, 0);
+        return;
+    }
+
+    long rss_start = peak_rss_kb();
+    auto* book = new Book();
+    auto start = high_resolution_clock::now();
+    for (const auto& msg : stream) {
+        book->process_msg(msg);
+    }
+    auto end = high_resolution_clock::now();
+    long rss_end = peak_rss_kb();
+
+    std::cout << std::left << std::setw(22) << name << std::right
+              << std::setw(12) << duration_cast<milliseconds>(end - start).count()
+              << std::setw(16) << rss_end - rss_start
+              << std::setw(14) << book->get_count() << "\n";
+    std::cout.flush();
+    _exit(0);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " <input_file>\n";
+        return 1;
+    }
+
+    try {
+        Parser parser(argv[1]);
+        parser.parse();
+
+        std::cout << "sizeof(MapOrder) " << sizeof(MapOrder) << ", sizeof(InlineOrder) " << sizeof(InlineOrder)
+                  << " (+1 control byte)\n";
+        std::cout << std::left << std::setw(22) << "book" << std::right << std::setw(12) << "replay ms"
+                  << std::setw(16) << "peak rss kb" << std::setw(14) << "live orders" << "\n";
+
+        run<Ladder_Orderbook<OpenAddressTable>>("ladder/robin_hood", parser.message_stream_);
+        run<Ladder_Orderbook<SwissTable>>("ladder/swiss", parser.message_stream_);
+        run<InlineLadder_Orderbook>("ladder_inline", parser.message_stream_);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
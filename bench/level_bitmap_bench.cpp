@@ -0,0 +1,98 @@
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <vector>
+#include "../ladder/level_bitmap.h"
+#include "../map/map_limit.cpp"
+
+using namespace std::chrono;
+
+// sweeps the touch from the top of a bid side down to the last level: erase the best level,
+// then ask for the new best. compares a std::map (what Orderbook does), a linear scan over the
+// ladder slots (what the ladder did before the bitmap) and the LevelBitmap
+
+static std::vector<size_t> make_slots(size_t depth, double density, std::mt19937_64& rng) {
+    std::bernoulli_distribution occupied(density);
+    std::vector<size_t> slots;
+    for (size_t i = 0; i < depth; ++i) {
+        if (occupied(rng)) slots.push_back(i);
+    }
+    if (slots.empty()) slots.push_back(depth - 1);
+    return slots;
+}
+
+static double sweep_map(const std::vector<size_t>& slots, MapLimit* limit, uint64_t& checksum) {
+    std::map<int32_t, MapLimit*, std::greater<>> bids;
+    for (size_t slot : slots) bids.emplace(static_cast<int32_t>(slot), limit);
+
+    auto start = high_resolution_clock::now();
+    while (!bids.empty()) {
+        bids.erase(bids.begin());
+        if (!bids.empty()) checksum += bids.begin()->first;
+    }
+    auto end = high_resolution_clock::now();
+    return static_cast<double>(duration_cast<nanoseconds>(end - start).count()) / slots.size();
+}
+
+static double sweep_scan(const std::vector<size_t>& slots, size_t depth, uint64_t& checksum) {
+    std::vector<uint8_t> occupied(depth, 0);
+    for (size_t slot : slots) occupied[slot] = 1;
+
+    auto start = high_resolution_clock::now();
+    size_t best = slots.back();
+    size_t remaining = slots.size();
+    while (remaining) {
+        occupied[best] = 0;
+        if (--remaining == 0) break;
+        while (!occupied[best]) --best;
+        checksum += best;
+    }
+    auto end = high_resolution_clock::now();
+    return static_cast<double>(duration_cast<nanoseconds>(end - start).count()) / slots.size();
+}
+
+static double sweep_bitmap(const std::vector<size_t>& slots, size_t depth, uint64_t& checksum) {
+    LevelBitmap occupied(depth);
+    for (size_t slot : slots) occupied.set(slot);
+
+    auto start = high_resolution_clock::now();
+    size_t best = occupied.find_last();
+    while (best != LevelBitmap::NONE) {
+        occupied.reset(best);
+        best = occupied.find_prev(best);
+        if (best != LevelBitmap::NONE) checksum += best;
+    }
+    auto end = high_resolution_clock::now();
+    return static_cast<double>(duration_cast<nanoseconds>(end - start).count()) / slots.size();
+}
+
+int main() {
+    std::mt19937_64 rng(42);
+    MapLimit limit(0);
+    uint64_t checksum = 0;
+
+    std::cout << std::setw(8) << "depth" << std::setw(10) << "density" << std::setw(10) << "levels"
+              << std::setw(14) << "map ns/op" << std::setw(14) << "scan ns/op"
+              << std::setw(16) << "bitmap ns/op" << "\n";
+
+    for (size_t depth : {256ul, 4096ul, 65536ul, 1048576ul}) {
+        for (double density : {1.0, 0.1, 0.01, 0.001}) {
+            auto slots = make_slots(depth, density, rng);
+            double map_ns = sweep_map(slots, &limit, checksum);
+            double scan_ns = sweep_scan(slots, depth, checksum);
+            double bitmap_ns = sweep_bitmap(slots, depth, checksum);
+
+            std::cout << std::setw(8) << depth << std::setw(10) << density << std::setw(10) << slots.size()
+                      << std::fixed << std::setprecision(2)
+                      << std::setw(14) << map_ns << std::setw(14) << scan_ns
+                      << std::setw(16) << bitmap_ns << "\n";
+            std::cout.unsetf(std::ios::fixed);
+        }
+    }
+
+    std::cout << "checksum " << checksum << "\n";
+    return 0;
+}
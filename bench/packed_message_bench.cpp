@@ -0,0 +1,104 @@
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include "../parser.cpp"
+#include "../packed_message.h"
+#include "../platform.h"
+#include "../map/map_orderbook.cpp"
+#include "../ladder/ladder_orderbook.cpp"
+#include "../ladder/inline_ladder_orderbook.cpp"
+
+// replays a file as message (32 bytes) and as PackedMessage (24 bytes + the odd escaped timestamp).
+// first a bare loop that reads every field and does nothing else, repeated REPS times, which is about as
+// close to pure memory bandwidth as the replay gets, then the full replay into each book with both layouts,
+// checking both layouts end with the same book
+
+static constexpr int REPS = 10;
+
+struct Checksum {
+    uint64_t value_ = 0;
+
+    template<typename Msg>
+    __attribute__((always_inline))
+    void add(const Msg& msg) {
+        value_ += msg.id() ^ msg.time() ^ msg.size() ^ static_cast<uint32_t>(msg.price())
+                  ^ static_cast<uint64_t>(msg.action()) ^ msg.side();
+    }
+};
+
+static void print_scan(const char* name, size_t messages, size_t bytes, uint64_t ns, uint64_t checksum) {
+    std::cout << std::left << std::setw(10) << name << std::right << std::fixed << std::setprecision(2)
+              << std::setw(12) << static_cast<double>(bytes) / messages
+              << std::setw(10) << static_cast<double>(ns) / (static_cast<double>(messages) * REPS)
+              << std::setw(10) << static_cast<double>(bytes) * REPS / ns
+              << "   " << std::hex << checksum << std::dec << "\n";
+    std::cout.unsetf(std::ios::fixed);
+}
+
+template<typename Book>
+static void replay_both(const char* name, const std::vector<message>& stream, const PackedMessageStream& packed) {
+    auto* plain_book = new Book();
+    platform::Stopwatch timer;
+    for (const auto& msg : stream) {
+        plain_book->process_msg(msg);
+    }
+    uint64_t plain_ns = timer.elapsed_ns();
+
+    auto* packed_book = new Book();
+    timer.reset();
+    packed.for_each([packed_book](const PackedMessageView& msg) { packed_book->process_msg(msg); });
+    uint64_t packed_ns = timer.elapsed_ns();
+
+    bool same = plain_book->get_count() == packed_book->get_count()
+                && plain_book->get_best_bid_price() == packed_book->get_best_bid_price()
+                && plain_book->get_best_ask_price() == packed_book->get_best_ask_price();
+    std::cout << std::left << std::setw(22) << name << std::right
+              << std::setw(10) << plain_ns / 1000000 << std::setw(10) << packed_ns / 1000000
+              << std::setw(10) << (same ? "yes" : "NO") << "\n";
+    delete plain_book;
+    delete packed_book;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " <input_file>\n";
+        return 1;
+    }
+
+    try {
+        Parser parser(argv[1]);
+        parser.parse();
+        const auto& stream = parser.message_stream_;
+        PackedMessageStream packed = PackedMessageStream::encode(MessageSpan(stream));
+
+        std::cout << stream.size() << " messages, " << packed.escaped() << " timestamps escaped\n";
+        std::cout << std::left << std::setw(10) << "layout" << std::right << std::setw(12) << "bytes/msg"
+                  << std::setw(10) << "ns/msg" << std::setw(10) << "GB/s" << "   checksum\n";
+
+        Checksum plain_sum;
+        platform::Stopwatch timer;
+        for (int rep = 0; rep < REPS; ++rep) {
+            for (const auto& msg : stream) plain_sum.add(msg);
+        }
+        print_scan("message", stream.size(), stream.size() * sizeof(message), timer.elapsed_ns(), plain_sum.value_);
+
+        Checksum packed_sum;
+        timer.reset();
+        for (int rep = 0; rep < REPS; ++rep) {
+            packed.for_each([&packed_sum](const PackedMessageView& msg) { packed_sum.add(msg); });
+        }
+        print_scan("packed", packed.size(), packed.bytes(), timer.elapsed_ns(), packed_sum.value_);
+
+        std::cout << "\n" << std::left << std::setw(22) << "book" << std::right << std::setw(10) << "plain ms"
+                  << std::setw(10) << "packed ms" << std::setw(10) << "same" << "\n";
+        replay_both<Orderbook<OpenAddressTable>>("map", stream, packed);
+        replay_both<Ladder_Orderbook<OpenAddressTable>>("ladder", stream, packed);
+        replay_both<InlineLadder_Orderbook>("ladder_inline", stream, packed);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,79 @@
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "../parser.cpp"
+#include "../platform.h"
+
+// parses a file with the original strchr/strtoull line parser and with the simd tokenizer + swar decode,
+// reports both times and checks the two message streams are identical field for field. then parses it
+// again with 1, 2, 4 ... max_threads threads (default: all cores) and reports MB/s for each thread count
+
+static bool same(const message& a, const message& b) {
+    return a.id_ == b.id_ && a.time_ == b.time_ && a.size_ == b.size_ && a.price_ == b.price_
+           && a.action_ == b.action_ && a.side_ == b.side_;
+}
+
+static uint64_t timed_parse(Parser& parser, ParseMode mode, size_t threads = 1) {
+    platform::Stopwatch timer;
+    parser.parse(mode, threads);
+    return timer.elapsed_ns();
+}
+
+static size_t count_mismatches(const std::vector<message>& expected, const std::vector<message>& actual) {
+    size_t mismatches = expected.size() == actual.size() ? 0 : 1;
+    for (size_t i = 0; i < std::min(expected.size(), actual.size()); ++i) {
+        if (!same(expected[i], actual[i])) {
+            if (mismatches++ < 5) {
+                std::cerr << "message " << i << " differs: id " << expected[i].id_ << " vs " << actual[i].id_
+                          << ", price " << expected[i].price_ << " vs " << actual[i].price_ << "\n";
+            }
+        }
+    }
+    return mismatches;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 2 && argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " <input_file> [max_threads]\n";
+        return 1;
+    }
+
+    try {
+        Parser scalar(argv[1]);
+        Parser simd(argv[1]);
+        uint64_t scalar_ns = timed_parse(scalar, ParseMode::scalar);
+        uint64_t simd_ns = timed_parse(simd, ParseMode::simd);
+
+        const auto& expected = scalar.message_stream_;
+        const auto& actual = simd.message_stream_;
+        size_t mismatches = count_mismatches(expected, actual);
+
+        std::cout << std::fixed << std::setprecision(1)
+                  << "scalar: " << scalar_ns / 1e6 << "ms, simd: " << simd_ns / 1e6 << "ms, speedup "
+                  << std::setprecision(2) << static_cast<double>(scalar_ns) / simd_ns << "x\n"
+                  << expected.size() << " vs " << actual.size() << " messages, " << mismatches << " mismatches\n";
+
+        size_t max_threads = argc == 3 ? std::stoul(argv[2]) : std::max(1u, std::thread::hardware_concurrency());
+        const double mb = scalar.get_file_size() / 1e6;
+        std::cout << std::setw(8) << "threads" << std::setw(10) << "ms" << std::setw(10) << "MB/s"
+                  << std::setw(12) << "mismatches" << "\n";
+        std::vector<size_t> thread_counts;
+        for (size_t threads = 1; threads < max_threads; threads *= 2) thread_counts.push_back(threads);
+        thread_counts.push_back(max_threads);
+        for (size_t threads : thread_counts) {
+            Parser parallel(argv[1]);
+            uint64_t ns = timed_parse(parallel, ParseMode::simd, threads);
+            size_t thread_mismatches = count_mismatches(expected, parallel.message_stream_);
+            mismatches += thread_mismatches;
+            std::cout << std::setprecision(1) << std::setw(8) << threads << std::setw(10) << ns / 1e6
+                      << std::setw(10) << mb / (ns / 1e9) << std::setw(12) << thread_mismatches << "\n";
+        }
+        return mismatches ? 1 : 0;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,99 @@
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "../vector/order_pool.h"
+#include "../map/map_order_pool.cpp"
+
+using namespace std::chrono;
+
+// construction time and peak rss of the order pools, the old make_unique per order pool vs the slab
+// pool with and without huge pages. each variant runs in its own forked child so peak rss isn't
+// polluted by the previous run
+
+static constexpr size_t POOL_SIZE = 1000000;
+static constexpr size_t LIVE_ORDERS = 250000;
+
+// what OrderPool used to do
+template<typename T>
+class LegacyPool {
+private:
+    std::vector<std::unique_ptr<T>> pool_;
+    std::vector<T*> available_orders_;
+
+public:
+    explicit LegacyPool(size_t initial_size) {
+        pool_.reserve(initial_size);
+        available_orders_.reserve(initial_size);
+        for (size_t i = 0; i < initial_size; ++i) {
+            pool_.push_back(std::make_unique<T>());
+            available_orders_.push_back(pool_.back().get());
+        }
+    }
+
+    T* get_order() {
+        T* order = available_orders_.back();
+        available_orders_.pop_back();
+        return order;
+    }
+};
+
+static long peak_rss_kb() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+template<typename Pool, typename... Args>
+static void run(const char* name, Args... args) {
+    std::cout.flush();
+    pid_t pid = fork();
+    if (pid != 0) {
+        waitpid(pid, nullptr, 0);
+        return;
+    }
+
+    long rss_start = peak_rss_kb();
+    auto start = high_resolution_clock::now();
+    auto* pool = new Pool(POOL_SIZE, args...);
+    auto end = high_resolution_clock::now();
+    long rss_built = peak_rss_kb();
+
+    uint64_t checksum = 0;
+    for (size_t i = 0; i < LIVE_ORDERS; ++i) {
+        auto* order = pool->get_order();
+        order->id_ = i;
+        checksum += reinterpret_cast<uintptr_t>(order) & 0xff;
+    }
+    long rss_used = peak_rss_kb();
+
+    std::cout << std::left << std::setw(24) << name << std::right
+              << std::setw(12) << duration_cast<microseconds>(end - start).count()
+              << std::setw(16) << rss_built - rss_start
+              << std::setw(18) << rss_used - rss_start
+              << "   (" << checksum << ")\n";
+    std::cout.flush();
+    _exit(0);
+}
+
+int main() {
+    std::cout << std::left << std::setw(24) << "pool" << std::right << std::setw(12) << "build us"
+              << std::setw(16) << "rss built kb" << std::setw(18) << "rss 250k live kb" << "\n";
+
+    run<LegacyPool<Order>>("legacy Order");
+    run<OrderPool>("slab Order", false);
+    run<OrderPool>("slab Order (huge)", true);
+    run<LegacyPool<MapOrder>>("legacy MapOrder");
+    run<MapOrderPool>("slab MapOrder", false);
+    run<MapOrderPool>("slab MapOrder (huge)", true);
+    return 0;
+}
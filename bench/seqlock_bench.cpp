@@ -0,0 +1,147 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "../parser.cpp"
+#include "../top_of_book.h"
+#include "../platform.h"
+#include "../ladder/inline_ladder_orderbook.cpp"
+
+// replays a file into a bare book, then through PublishedBook with 0, 1, 2, 4 and 8 reader threads
+// spinning on the snapshot, for top of book and for 5 levels. reports the writer's ns/msg and overhead over
+// the bare replay, the readers' consistent reads per second and retry rate, and staleness: how old the
+// copy a reader got was (now - publish time, p50/p99) and how many versions behind the latest it was by
+// the time it finished reading. readers also check every copy they get has a sequence at least as new
+// as their previous one. pass first_cpu to pin the writer there and the readers on the cores after it
+
+static constexpr size_t AGE_SAMPLE_EVERY = 16;
+static constexpr size_t MAX_AGE_SAMPLES = 1 << 20;
+
+struct ReaderStats {
+    uint64_t reads_ = 0;
+    uint64_t retries_ = 0;
+    uint64_t versions_behind_ = 0;
+    uint64_t out_of_order_ = 0;
+    std::vector<uint64_t> age_cycles_;
+};
+
+template<size_t Depth>
+static void run(const char* name, const std::vector<message>& stream, size_t readers, int first_cpu, uint64_t bare_ns,
+                double cycles_per_ns) {
+    auto* book = new InlineLadder_Orderbook();
+    PublishedBook<InlineLadder_Orderbook, Depth> published(*book);
+    std::atomic<bool> done{false};
+    std::atomic<size_t> ready{0};
+
+    std::vector<ReaderStats> stats(readers);
+    std::vector<std::thread> threads;
+    for (size_t r = 0; r < readers; ++r) {
+        threads.emplace_back([&, r] {
+            platform::pin_thread(first_cpu < 0 ? -1 : first_cpu + 1 + static_cast<int>(r));
+            ReaderStats local;
+            local.age_cycles_.reserve(MAX_AGE_SAMPLES);
+            typename PublishedBook<InlineLadder_Orderbook, Depth>::Snapshot snapshot;
+            uint64_t version = 0;
+            uint64_t last_sequence = 0;
+            ready.fetch_add(1);
+            while (!done.load(std::memory_order_relaxed)) {
+                if (!published.snapshot().try_load(snapshot, version)) {
+                    ++local.retries_;
+                    platform::cpu_relax();
+                    continue;
+                }
+                const uint64_t now = platform::cycles();
+                local.versions_behind_ += (published.snapshot().version() - version) / 2;
+                local.out_of_order_ += snapshot.sequence_ < last_sequence;
+                last_sequence = snapshot.sequence_;
+                if (version && local.reads_ % AGE_SAMPLE_EVERY == 0 && local.age_cycles_.size() < MAX_AGE_SAMPLES) {
+                    local.age_cycles_.push_back(now - snapshot.publish_cycles_);
+                }
+                ++local.reads_;
+            }
+            stats[r] = std::move(local);
+        });
+    }
+    while (ready.load() != readers) platform::cpu_relax();
+
+    platform::pin_thread(first_cpu);
+    platform::Stopwatch timer;
+    for (const auto& msg : stream) {
+        published.process_msg(msg);
+    }
+    const uint64_t writer_ns = timer.elapsed_ns();
+    done.store(true);
+    for (auto& thread : threads) thread.join();
+
+    ReaderStats total;
+    for (auto& reader : stats) {
+        total.reads_ += reader.reads_;
+        total.retries_ += reader.retries_;
+        total.versions_behind_ += reader.versions_behind_;
+        total.out_of_order_ += reader.out_of_order_;
+        total.age_cycles_.insert(total.age_cycles_.end(), reader.age_cycles_.begin(), reader.age_cycles_.end());
+    }
+    std::sort(total.age_cycles_.begin(), total.age_cycles_.end());
+    auto age_ns = [&total, cycles_per_ns](double p) {
+        if (total.age_cycles_.empty()) return 0.0;
+        return total.age_cycles_[static_cast<size_t>(p * (total.age_cycles_.size() - 1))] / cycles_per_ns;
+    };
+
+    const double writer_per_msg = static_cast<double>(writer_ns) / stream.size();
+    std::cout << std::left << std::setw(8) << name << std::right << std::setw(8) << readers << std::fixed
+              << std::setprecision(1) << std::setw(10) << writer_per_msg
+              << std::setw(10) << (static_cast<double>(writer_ns) / bare_ns - 1.0) * 100 << "%"
+              << std::setw(12) << (readers ? total.reads_ / (writer_ns / 1e9) / readers / 1e6 : 0.0)
+              << std::setw(9) << (total.reads_ ? 100.0 * total.retries_ / (total.reads_ + total.retries_) : 0.0) << "%"
+              << std::setw(12) << age_ns(0.5) / 1000 << std::setw(12) << age_ns(0.99) / 1000
+              << std::setprecision(3) << std::setw(10)
+              << (total.reads_ ? static_cast<double>(total.versions_behind_) / total.reads_ : 0.0)
+              << std::setw(8) << (total.out_of_order_ == 0 ? "yes" : "NO") << "\n";
+    std::cout.unsetf(std::ios::fixed);
+    delete book;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 2 && argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " <input_file> [first_cpu]\n";
+        return 1;
+    }
+    const int first_cpu = argc == 3 ? std::stoi(argv[2]) : -1;
+
+    try {
+        Parser parser(argv[1]);
+        parser.parse();
+        const auto& stream = parser.message_stream_;
+        const double cycles_per_ns = platform::cycles_per_ns();
+
+        auto* bare = new InlineLadder_Orderbook();
+        platform::pin_thread(first_cpu);
+        platform::Stopwatch timer;
+        for (const auto& msg : stream) bare->process_msg(msg);
+        const uint64_t bare_ns = timer.elapsed_ns();
+        delete bare;
+
+        std::cout << stream.size() << " messages, bare replay " << std::fixed << std::setprecision(1)
+                  << static_cast<double>(bare_ns) / stream.size() << " ns/msg, " << std::thread::hardware_concurrency()
+                  << " cores\n";
+        std::cout.unsetf(std::ios::fixed);
+        std::cout << std::left << std::setw(8) << "depth" << std::right << std::setw(8) << "readers"
+                  << std::setw(10) << "ns/msg" << std::setw(11) << "overhead" << std::setw(12) << "M reads/s"
+                  << std::setw(10) << "retries" << std::setw(12) << "age p50 us" << std::setw(12) << "age p99 us"
+                  << std::setw(10) << "behind" << std::setw(8) << "ordered" << "\n";
+        for (size_t readers : {0, 1, 2, 4, 8}) {
+            run<1>("top", stream, readers, first_cpu, bare_ns, cycles_per_ns);
+        }
+        for (size_t readers : {0, 1, 2, 4, 8}) {
+            run<5>("5 lvl", stream, readers, first_cpu, bare_ns, cycles_per_ns);
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,97 @@
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../parser.cpp"
+#include "../book_manager.h"
+#include "../sharded_replay.h"
+#include "../platform.h"
+#include "../ladder/inline_ladder_orderbook.cpp"
+
+// replays a multi instrument csv (7th column instrument_id) single threaded through a BookManager, then
+// sharded over 1..max_shards workers, each run into fresh books. reports messages per second, speedup over
+// the single threaded loop, how uneven the shards were (busiest shard's messages over the mean) and checks
+// every run ends with the same resting orders and touch on every instrument. pass first_cpu to pin the
+// dispatcher there and the workers on the cores after it
+
+using Book = InlineLadder_Orderbook;
+static constexpr size_t ORDERS_PER_INSTRUMENT = 1 << 14;
+
+struct BookState {
+    uint64_t count_ = 0;
+    int64_t touch_ = 0;
+
+    bool operator==(const BookState& other) const { return count_ == other.count_ && touch_ == other.touch_; }
+};
+
+static BookManager<Book> make_manager() {
+    return BookManager<Book>([] { return std::make_unique<Book>(1, ORDERS_PER_INSTRUMENT); });
+}
+
+static std::vector<BookState> snapshot(BookManager<Book>& manager) {
+    std::vector<BookState> states;
+    manager.for_each_book([&states](uint32_t, Book& book) {
+        BookState state;
+        state.count_ = book.get_count();
+        if (state.count_) state.touch_ = static_cast<int64_t>(book.get_best_bid_price()) * 3 + book.get_best_ask_price();
+        states.push_back(state);
+    });
+    return states;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2 || argc > 4) {
+        std::cerr << "Usage: " << argv[0] << " <instrument_csv> [max_shards] [first_cpu]\n";
+        return 1;
+    }
+
+    const size_t max_shards = argc >= 3 ? std::stoul(argv[2]) : std::max(1u, std::thread::hardware_concurrency() - 1);
+    const int first_cpu = argc == 4 ? std::stoi(argv[3]) : -1;
+
+    try {
+        std::vector<InstrumentMessage> raw;
+        Parser(argv[1]).parse_instruments_into(raw);
+
+        auto reference = make_manager();
+        std::vector<InstrumentMessage> messages = raw;
+        reference.localize(messages);
+        platform::Stopwatch timer;
+        for (const auto& msg : messages) reference.process_msg(msg);
+        const uint64_t single_ns = timer.elapsed_ns();
+        const auto expected = snapshot(reference);
+
+        std::cout << raw.size() << " messages, " << reference.size() << " instruments, "
+                  << std::thread::hardware_concurrency() << " cores\n";
+        std::cout << std::left << std::setw(8) << "shards" << std::right << std::setw(12) << "M msgs/s"
+                  << std::setw(10) << "speedup" << std::setw(11) << "imbalance" << std::setw(10) << "stalls"
+                  << std::setw(8) << "same" << "\n";
+        std::cout << std::fixed << std::setprecision(2);
+        std::cout << std::left << std::setw(8) << "single" << std::right << std::setw(12) << raw.size() / (single_ns / 1e9) / 1e6
+                  << std::setw(10) << 1.0 << std::setw(11) << 1.0 << std::setw(10) << 0 << std::setw(8) << "-" << "\n";
+
+        for (size_t shards = 1; shards <= max_shards; ++shards) {
+            auto manager = make_manager();
+            messages = raw;
+            manager.localize(messages);
+
+            ShardedOptions options;
+            options.shards = shards;
+            options.first_cpu = first_cpu;
+            ShardedStats stats = run_sharded(messages, manager, options);
+
+            bool same = stats.messages_ == raw.size() && snapshot(manager) == expected;
+            std::cout << std::left << std::setw(8) << shards << std::right
+                      << std::setw(12) << stats.messages_ / (stats.elapsed_ns_ / 1e9) / 1e6
+                      << std::setw(10) << static_cast<double>(single_ns) / stats.elapsed_ns_
+                      << std::setw(11) << stats.imbalance() << std::setw(10) << stats.dispatcher_stalls_
+                      << std::setw(8) << (same ? "yes" : "NO") << "\n";
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "../parser.cpp"
+
+using namespace std::chrono;
+
+// replays a file against the sorted level vectors only and counts how many (price, limit) pairs
+// std::vector::emplace/erase have to shift, with the best level at the front of each side
+// versus at the back (what Vector_Orderbook does)
+
+template<bool BestAtBack>
+class LevelLayout {
+private:
+    using Level = std::pair<int32_t, uint32_t>;
+    std::vector<Level> bids_;
+    std::vector<Level> offers_;
+
+    // bids are worse when lower, offers are worse when higher, worse levels go towards the front
+    // when the best is at the back and towards the back when the best is at the front
+    static bool before(bool side, int32_t a, int32_t b) {
+        bool worse = side ? a < b : a > b;
+        bool better = side ? a > b : a < b;
+        return BestAtBack ? worse : better;
+    }
+
+public:
+    uint64_t moves_ = 0;
+    uint64_t inserts_ = 0;
+    uint64_t erases_ = 0;
+
+    LevelLayout() {
+        bids_.reserve(1000);
+        offers_.reserve(1000);
+    }
+
+    void add(bool side, int32_t price) {
+        auto& levels = side ? bids_ : offers_;
+        auto it = std::lower_bound(levels.begin(), levels.end(), price,
+                                   [side](const Level& a, int32_t b) { return before(side, a.first, b); });
+        if (it != levels.end() && it->first == price) {
+            ++it->second;
+            return;
+        }
+        moves_ += static_cast<uint64_t>(levels.end() - it);
+        ++inserts_;
+        levels.emplace(it, price, 1);
+    }
+
+    void remove(bool side, int32_t price) {
+        auto& levels = side ? bids_ : offers_;
+        auto it = std::lower_bound(levels.begin(), levels.end(), price,
+                                   [side](const Level& a, int32_t b) { return before(side, a.first, b); });
+        if (it == levels.end() || it->first != price) return;
+        if (--it->second != 0) return;
+
+        moves_ += static_cast<uint64_t>(levels.end() - it - 1);
+        ++erases_;
+        levels.erase(it);
+    }
+};
+
+template<bool BestAtBack>
+void replay(const std::vector<message>& stream, const char* name) {
+    LevelLayout<BestAtBack> layout;
+    std::unordered_map<uint64_t, std::pair<bool, int32_t>> orders;
+    orders.reserve(1000000);
+
+    auto start = high_resolution_clock::now();
+    for (const auto& msg : stream) {
+        switch (msg.action_) {
+            case 'A':
+                orders[msg.id_] = {msg.side_, msg.price_};
+                layout.add(msg.side_, msg.price_);
+                break;
+            case 'C': {
+                auto it = orders.find(msg.id_);
+                if (it == orders.end()) break;
+                layout.remove(it->second.first, it->second.second);
+                orders.erase(it);
+                break;
+            }
+            case 'M': {
+                auto it = orders.find(msg.id_);
+                if (it == orders.end()) {
+                    orders[msg.id_] = {msg.side_, msg.price_};
+                    layout.add(msg.side_, msg.price_);
+                } else if (it->second.second != msg.price_) {
+                    layout.remove(it->second.first, it->second.second);
+                    it->second.second = msg.price_;
+                    layout.add(msg.side_, msg.price_);
+                }
+                break;
+            }
+        }
+    }
+    auto end = high_resolution_clock::now();
+
+    uint64_t ops = layout.inserts_ + layout.erases_;
+    std::cout << name << ": " << layout.inserts_ << " level inserts, " << layout.erases_ << " level erases, "
+              << layout.moves_ << " pair moves (" << (ops ? static_cast<double>(layout.moves_) / ops : 0.0)
+              << " per op) in " << duration_cast<milliseconds>(end - start).count() << "ms\n";
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " <input_file>\n";
+        return 1;
+    }
+
+    try {
+        Parser parser(argv[1]);
+        parser.parse();
+        replay<false>(parser.message_stream_, "best at front");
+        replay<true>(parser.message_stream_, "best at back ");
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,18 @@
+#ifndef VECTOR_OB_BOOK_LEVEL_H
+#define VECTOR_OB_BOOK_LEVEL_H
+
+#include <cstdint>
+
+// one aggregated price level as the books hand it out through get_top_levels<Side>(out, n), best first
+struct BookLevel {
+    int32_t price_;
+    uint32_t orders_;
+    uint64_t volume_;
+
+    bool operator==(const BookLevel& other) const {
+        return price_ == other.price_ && orders_ == other.orders_ && volume_ == other.volume_;
+    }
+    bool operator!=(const BookLevel& other) const { return !(*this == other); }
+};
+
+#endif //VECTOR_OB_BOOK_LEVEL_H
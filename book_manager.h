@@ -0,0 +1,82 @@
+#ifndef VECTOR_OB_BOOK_MANAGER_H
+#define VECTOR_OB_BOOK_MANAGER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "message.h"
+
+// one book per instrument for files that carry a whole product complex. instruments get a dense local id
+// in order of first appearance, and the books sit in a flat array indexed by it, so routing a message is
+// one array load. exchange instrument ids are sparse 32 bit numbers, the hash from those to local ids is
+// only used by localize(), which rewrites instrument_id_ in place once before replay, never per message.
+// Book is any of the books, make_book builds a new one (sized for one instrument rather than the
+// default million orders) the first time an instrument shows up
+template<typename Book>
+class BookManager {
+public:
+    using BookFactory = std::function<std::unique_ptr<Book>()>;
+
+    explicit BookManager(BookFactory make_book = [] { return std::make_unique<Book>(); })
+            : make_book_(std::move(make_book)) {}
+
+    BookManager(const BookManager&) = delete;
+    BookManager& operator=(const BookManager&) = delete;
+
+    // local id for an exchange instrument id, adding a book for it if it's new
+    uint32_t local_id(uint32_t instrument_id) {
+        auto [it, inserted] = local_ids_.try_emplace(instrument_id, static_cast<uint32_t>(books_.size()));
+        if (inserted) {
+            books_.push_back(make_book_());
+            instrument_ids_.push_back(instrument_id);
+        }
+        return it->second;
+    }
+
+    // swaps every message's exchange instrument id for its local id. runs of the same instrument skip
+    // the hash
+    void localize(std::vector<InstrumentMessage>& messages) {
+        uint32_t last_instrument = 0;
+        uint32_t last_local = UINT32_MAX;
+        for (auto& msg : messages) {
+            if (msg.instrument_id_ != last_instrument || last_local == UINT32_MAX) {
+                last_instrument = msg.instrument_id_;
+                last_local = local_id(msg.instrument_id_);
+            }
+            msg.instrument_id_ = last_local;
+        }
+    }
+
+    // msg.instrument_id() has to be a local id, ie the message went through localize()
+    template<typename Msg>
+    __attribute__((always_inline))
+    void process_msg(const Msg& msg) {
+        books_[msg.instrument_id()]->process_msg(msg);
+    }
+
+    size_t size() const { return books_.size(); }
+
+    Book& book(uint32_t local_id) { return *books_[local_id]; }
+    const Book& book(uint32_t local_id) const { return *books_[local_id]; }
+
+    uint32_t instrument_id(uint32_t local_id) const { return instrument_ids_[local_id]; }
+
+    // fn(exchange instrument id, book) for every instrument, in local id order
+    template<typename Fn>
+    void for_each_book(Fn&& fn) {
+        for (size_t i = 0; i < books_.size(); ++i) {
+            fn(instrument_ids_[i], *books_[i]);
+        }
+    }
+
+private:
+    std::vector<std::unique_ptr<Book>> books_;
+    std::vector<uint32_t> instrument_ids_;
+    std::unordered_map<uint32_t, uint32_t> local_ids_;
+    BookFactory make_book_;
+};
+
+#endif //VECTOR_OB_BOOK_MANAGER_H
@@ -0,0 +1,427 @@
+#ifndef VECTOR_OB_COMPRESSED_FILE_H
+#define VECTOR_OB_COMPRESSED_FILE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <numeric>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "message.h"
+#include "parser.cpp"
+
+// block compressed replay file, for the archive where disk reads cost more than decoding. records are
+// grouped into blocks of block_records_ (4096 by default), each block stands alone so replay can start at
+// any block, and an index of (offset, first timestamp, first record) per block sits at the end of the file.
+//
+// inside a block every field is its own column. timestamps and order ids are stored as the difference
+// from the previous record, prices as the difference in ticks (tick_ is the gcd of every price in the
+// file), all three zigzag encoded so small negative steps stay small, and sizes as is. each numeric column
+// is bit packed at the width of its largest value in the block, so unpacking is the same shift and mask
+// for every record with no branches (unlike varints), followed by a prefix sum for the delta columns.
+// actions are one byte each, sides one bit each. little endian only, like message_file.h
+
+static constexpr char COMPRESSED_FILE_MAGIC[8] = {'O', 'B', 'M', 'S', 'G', 'B', 'L', 'K'};
+static constexpr uint32_t COMPRESSED_FILE_VERSION = 1;
+static constexpr uint32_t DEFAULT_BLOCK_RECORDS = 4096;
+
+struct CompressedFileHeader {
+    char magic_[8];
+    uint32_t version_;
+    uint32_t block_records_;
+    uint64_t record_count_;
+    uint64_t block_count_;
+    uint64_t index_offset_;
+    int32_t tick_;
+    uint32_t reserved_;
+    char symbol_[32];
+};
+
+struct CompressedBlockHeader {
+    uint32_t count_;
+    uint8_t time_bits_;
+    uint8_t id_bits_;
+    uint8_t price_bits_;
+    uint8_t size_bits_;
+    uint64_t base_time_;
+    uint64_t base_id_;
+    int32_t base_price_;
+    // bytes in the block including this header, blocks are padded to 8
+    uint32_t bytes_;
+};
+
+struct BlockIndexEntry {
+    uint64_t offset_;
+    uint64_t first_time_;
+    uint64_t first_record_;
+};
+
+namespace bitpack {
+
+// spare bytes after every packed column, so the 8 byte loads in unpack never run off the end
+static constexpr size_t SLACK = 16;
+
+__attribute__((always_inline))
+inline uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+__attribute__((always_inline))
+inline int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+inline uint8_t bits_needed(const uint64_t* values, size_t n) {
+    uint64_t all = 0;
+    for (size_t i = 0; i < n; ++i) all |= values[i];
+    return all ? static_cast<uint8_t>(64 - __builtin_clzll(all)) : 0;
+}
+
+inline size_t packed_bytes(size_t n, unsigned bits) {
+    return (n * bits + 7) / 8 + SLACK;
+}
+
+inline void pack(std::vector<uint8_t>& out, const uint64_t* values, size_t n, unsigned bits) {
+    const size_t start = out.size();
+    out.resize(start + packed_bytes(n, bits), 0);
+    uint8_t* packed = out.data() + start;
+    for (size_t i = 0; i < n; ++i) {
+        const size_t bit_pos = i * bits;
+        unsigned written = 0;
+        while (written < bits) {
+            const size_t byte = (bit_pos + written) / 8;
+            const unsigned offset = (bit_pos + written) % 8;
+            const unsigned take = std::min(8 - offset, bits - written);
+            packed[byte] |= static_cast<uint8_t>(((values[i] >> written) & ((1u << take) - 1)) << offset);
+            written += take;
+        }
+    }
+}
+
+__attribute__((always_inline))
+inline uint64_t load64(const uint8_t* p) {
+    uint64_t word;
+    std::memcpy(&word, p, sizeof(word));
+    return word;
+}
+
+// one load, shift and mask per value while a value plus its bit offset fits in a 64 bit load (up to 56
+// bits), wider columns need a second load
+inline void unpack(const uint8_t* packed, size_t n, unsigned bits, uint64_t* out) {
+    if (bits == 0) {
+        std::fill(out, out + n, 0);
+    } else if (bits <= 56) {
+        const uint64_t mask = (1ULL << bits) - 1;
+        for (size_t i = 0; i < n; ++i) {
+            const size_t bit_pos = i * bits;
+            out[i] = (load64(packed + bit_pos / 8) >> (bit_pos % 8)) & mask;
+        }
+    } else {
+        const uint64_t mask = bits == 64 ? ~0ULL : (1ULL << bits) - 1;
+        for (size_t i = 0; i < n; ++i) {
+            const size_t bit_pos = i * bits;
+            const unsigned offset = bit_pos % 8;
+            uint64_t value = load64(packed + bit_pos / 8) >> offset;
+            if (offset) value |= load64(packed + bit_pos / 8 + 8) << (64 - offset);
+            out[i] = value & mask;
+        }
+    }
+}
+
+} // namespace bitpack
+
+inline void write_compressed_file(const std::string& path, MessageSpan messages, const std::string& symbol,
+                                  uint32_t block_records = DEFAULT_BLOCK_RECORDS) {
+    if (block_records == 0) {
+        throw ParserException("Compressed message file blocks need at least one record: " + path);
+    }
+    // on magnitudes, std::gcd of INT32_MIN is undefined. every price being 0 or INT32_MIN would make it 2^31,
+    // which doesn't fit the header, 1 works for anything
+    uint32_t gcd = 0;
+    for (const auto& msg : messages) {
+        gcd = std::gcd(gcd, msg.price_ < 0 ? 0u - static_cast<uint32_t>(msg.price_) : static_cast<uint32_t>(msg.price_));
+    }
+    const int32_t tick = gcd == 0 || gcd > INT32_MAX ? 1 : static_cast<int32_t>(gcd);
+
+    CompressedFileHeader header{};
+    std::memcpy(header.magic_, COMPRESSED_FILE_MAGIC, sizeof(header.magic_));
+    header.version_ = COMPRESSED_FILE_VERSION;
+    header.block_records_ = block_records;
+    header.record_count_ = messages.size();
+    header.tick_ = tick;
+    std::strncpy(header.symbol_, symbol.c_str(), sizeof(header.symbol_) - 1);
+
+    std::vector<uint8_t> body;
+    std::vector<BlockIndexEntry> index;
+    std::vector<uint64_t> times(block_records), ids(block_records), prices(block_records), sizes(block_records);
+
+    for (size_t start = 0; start < messages.size(); start += block_records) {
+        const size_t count = std::min<size_t>(block_records, messages.size() - start);
+        const message& first = messages[start];
+
+        // the first record's deltas are 0, it's the block's base
+        for (size_t i = 0; i < count; ++i) {
+            const message& msg = messages[start + i];
+            const message& prev = i ? messages[start + i - 1] : first;
+            times[i] = bitpack::zigzag(static_cast<int64_t>(msg.time_ - prev.time_));
+            ids[i] = bitpack::zigzag(static_cast<int64_t>(msg.id_ - prev.id_));
+            prices[i] = bitpack::zigzag((static_cast<int64_t>(msg.price_) - prev.price_) / tick);
+            sizes[i] = msg.size_;
+        }
+
+        CompressedBlockHeader block{};
+        block.count_ = static_cast<uint32_t>(count);
+        block.time_bits_ = bitpack::bits_needed(times.data(), count);
+        block.id_bits_ = bitpack::bits_needed(ids.data(), count);
+        block.price_bits_ = bitpack::bits_needed(prices.data(), count);
+        block.size_bits_ = bitpack::bits_needed(sizes.data(), count);
+        block.base_time_ = first.time_;
+        block.base_id_ = first.id_;
+        block.base_price_ = first.price_;
+
+        const size_t block_start = body.size();
+        index.push_back({sizeof(CompressedFileHeader) + block_start, first.time_, start});
+        body.resize(block_start + sizeof(CompressedBlockHeader));
+
+        bitpack::pack(body, times.data(), count, block.time_bits_);
+        bitpack::pack(body, ids.data(), count, block.id_bits_);
+        bitpack::pack(body, prices.data(), count, block.price_bits_);
+        bitpack::pack(body, sizes.data(), count, block.size_bits_);
+
+        const size_t actions_start = body.size();
+        body.resize(actions_start + count + (count + 7) / 8, 0);
+        for (size_t i = 0; i < count; ++i) {
+            const message& msg = messages[start + i];
+            body[actions_start + i] = static_cast<uint8_t>(msg.action_);
+            body[actions_start + count + i / 8] |= static_cast<uint8_t>(msg.side_ ? 1u << (i % 8) : 0u);
+        }
+
+        body.resize((body.size() + 7) & ~size_t{7}, 0);
+        block.bytes_ = static_cast<uint32_t>(body.size() - block_start);
+        std::memcpy(body.data() + block_start, &block, sizeof(block));
+    }
+
+    header.block_count_ = index.size();
+    header.index_offset_ = sizeof(CompressedFileHeader) + body.size();
+
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        throw ParserException("Failed to open for writing: " + path);
+    }
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1
+              && std::fwrite(body.data(), 1, body.size(), file) == body.size()
+              && std::fwrite(index.data(), sizeof(BlockIndexEntry), index.size(), file) == index.size();
+    if (std::fclose(file) != 0 || !ok) {
+        throw ParserException("Failed to write: " + path);
+    }
+}
+
+// read only mapping of a file written by write_compressed_file, decodes a block at a time into columns
+// and hands the records to fn in order
+class CompressedMessageFile {
+public:
+    explicit CompressedMessageFile(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd == -1) {
+            throw ParserException("Failed to open file: " + path);
+        }
+
+        struct stat sb;
+        if (fstat(fd, &sb) == -1) {
+            close(fd);
+            throw ParserException("Failed to get file stats");
+        }
+        file_size_ = sb.st_size;
+        if (file_size_ < sizeof(CompressedFileHeader)) {
+            close(fd);
+            throw ParserException("Not a compressed message file: " + path);
+        }
+
+        mapped_file_ = static_cast<const uint8_t*>(mmap(nullptr, file_size_, PROT_READ, MAP_PRIVATE, fd, 0));
+        close(fd);
+        if (mapped_file_ == MAP_FAILED) {
+            mapped_file_ = nullptr;
+            throw ParserException("Failed to memory map file");
+        }
+
+        const auto& h = header();
+        const char* error = nullptr;
+        if (std::memcmp(h.magic_, COMPRESSED_FILE_MAGIC, sizeof(h.magic_)) != 0) {
+            error = "Not a compressed message file: ";
+        } else if (h.version_ != COMPRESSED_FILE_VERSION) {
+            error = "Unsupported compressed message file version: ";
+        } else if (h.block_records_ == 0) {
+            error = "Corrupt compressed message file, zero records per block: ";
+        } else if (h.index_offset_ < sizeof(CompressedFileHeader) || h.index_offset_ > file_size_
+                   || h.block_count_ > (file_size_ - h.index_offset_) / sizeof(BlockIndexEntry)) {
+            error = "Truncated compressed message file: ";
+        } else if (!index_adds_up()) {
+            error = "Corrupt compressed message file index: ";
+        }
+        if (error) {
+            munmap(const_cast<uint8_t*>(mapped_file_), file_size_);
+            mapped_file_ = nullptr;
+            throw ParserException(error + path);
+        }
+
+        madvise(const_cast<uint8_t*>(mapped_file_), file_size_, MADV_SEQUENTIAL);
+        times_.resize(h.block_records_);
+        ids_.resize(h.block_records_);
+        prices_.resize(h.block_records_);
+        sizes_.resize(h.block_records_);
+    }
+
+    ~CompressedMessageFile() {
+        if (mapped_file_) munmap(const_cast<uint8_t*>(mapped_file_), file_size_);
+    }
+
+    CompressedMessageFile(const CompressedMessageFile&) = delete;
+    CompressedMessageFile& operator=(const CompressedMessageFile&) = delete;
+
+    static bool is_compressed_file(const std::string& path) {
+        char magic[sizeof(COMPRESSED_FILE_MAGIC)] = {};
+        FILE* file = std::fopen(path.c_str(), "rb");
+        if (!file) return false;
+        size_t read = std::fread(magic, 1, sizeof(magic), file);
+        std::fclose(file);
+        return read == sizeof(magic) && std::memcmp(magic, COMPRESSED_FILE_MAGIC, sizeof(magic)) == 0;
+    }
+
+    const CompressedFileHeader& header() const { return *reinterpret_cast<const CompressedFileHeader*>(mapped_file_); }
+
+    const BlockIndexEntry* index() const {
+        return reinterpret_cast<const BlockIndexEntry*>(mapped_file_ + header().index_offset_);
+    }
+
+    size_t block_count() const { return header().block_count_; }
+    size_t record_count() const { return header().record_count_; }
+    size_t get_file_size() const { return file_size_; }
+    std::string symbol() const { return std::string(header().symbol_, strnlen(header().symbol_, sizeof(header().symbol_))); }
+
+    // the block to start from to replay everything at or after time, ie the last block starting at or
+    // before it
+    size_t find_block(uint64_t time) const {
+        const BlockIndexEntry* begin = index();
+        const BlockIndexEntry* end = begin + block_count();
+        auto it = std::upper_bound(begin, end, time, [](uint64_t t, const BlockIndexEntry& entry) {
+            return t < entry.first_time_;
+        });
+        return it == begin ? 0 : static_cast<size_t>(it - begin - 1);
+    }
+
+    // decodes blocks [first_block, block_count()) and calls fn(const message&) on every record in order,
+    // returns the number of records
+    template<typename Fn>
+    size_t for_each(Fn&& fn, size_t first_block = 0) {
+        size_t count = 0;
+        for (size_t b = first_block; b < block_count(); ++b) {
+            count += decode_block(b, fn);
+        }
+        return count;
+    }
+
+private:
+    const uint8_t* mapped_file_ = nullptr;
+    size_t file_size_ = 0;
+    std::vector<uint64_t> times_;
+    std::vector<uint64_t> ids_;
+    std::vector<uint64_t> prices_;
+    std::vector<uint64_t> sizes_;
+
+    // the index's first_record_ has to start at 0 and climb by 1 to block_records_ a block, up to a last
+    // block that ends at record_count_. with every block's count_ checked against it in check_block, the
+    // blocks add up to record_count_ without reading every block header up front
+    bool index_adds_up() const {
+        const auto& h = header();
+        if (h.block_count_ == 0) return h.record_count_ == 0;
+        const BlockIndexEntry* entries = index();
+        if (entries[0].first_record_ != 0) return false;
+        for (size_t b = 0; b < h.block_count_; ++b) {
+            const uint64_t first = entries[b].first_record_;
+            const uint64_t next = b + 1 < h.block_count_ ? entries[b + 1].first_record_ : h.record_count_;
+            if (next <= first || next - first > h.block_records_) return false;
+        }
+        return true;
+    }
+
+    uint64_t records_in_block(size_t b) const {
+        const uint64_t next = b + 1 < block_count() ? index()[b + 1].first_record_ : header().record_count_;
+        return next - index()[b].first_record_;
+    }
+
+    // a block has to sit between the file header and the index, hold the records the index gives it and
+    // be long enough for the columns its header describes, checked like the file header in the constructor
+    // so a corrupt index or block header throws instead of reading past the mapping
+    const char* check_block(size_t b, uint64_t offset, const CompressedBlockHeader& block) const {
+        const uint64_t end = header().index_offset_;
+        if (block.count_ != records_in_block(b)) return "holds a different number of records than the index says";
+        if (block.bytes_ > end - offset) return "runs past the index";
+        if (block.time_bits_ > 64 || block.id_bits_ > 64 || block.price_bits_ > 64 || block.size_bits_ > 64) {
+            return "has a column wider than 64 bits";
+        }
+        const size_t n = block.count_;
+        const size_t needed = sizeof(block) + bitpack::packed_bytes(n, block.time_bits_)
+                              + bitpack::packed_bytes(n, block.id_bits_) + bitpack::packed_bytes(n, block.price_bits_)
+                              + bitpack::packed_bytes(n, block.size_bits_) + n + (n + 7) / 8;
+        if (needed > block.bytes_) return "is shorter than its columns";
+        return nullptr;
+    }
+
+    template<typename Fn>
+    size_t decode_block(size_t b, Fn& fn) {
+        const uint64_t offset = index()[b].offset_;
+        if (offset < sizeof(CompressedFileHeader) || offset > header().index_offset_
+            || header().index_offset_ - offset < sizeof(CompressedBlockHeader)) {
+            throw ParserException("Corrupt compressed message file, block " + std::to_string(b) + " starts outside the file");
+        }
+        const uint8_t* p = mapped_file_ + offset;
+        CompressedBlockHeader block;
+        std::memcpy(&block, p, sizeof(block));
+        if (const char* error = check_block(b, offset, block)) {
+            throw ParserException("Corrupt compressed message file, block " + std::to_string(b) + " " + error);
+        }
+        const size_t n = block.count_;
+        p += sizeof(block);
+
+        // unpack every column for the whole block first, then undo the deltas with prefix sums
+        bitpack::unpack(p, n, block.time_bits_, times_.data());
+        p += bitpack::packed_bytes(n, block.time_bits_);
+        bitpack::unpack(p, n, block.id_bits_, ids_.data());
+        p += bitpack::packed_bytes(n, block.id_bits_);
+        bitpack::unpack(p, n, block.price_bits_, prices_.data());
+        p += bitpack::packed_bytes(n, block.price_bits_);
+        bitpack::unpack(p, n, block.size_bits_, sizes_.data());
+        p += bitpack::packed_bytes(n, block.size_bits_);
+        const uint8_t* actions = p;
+        const uint8_t* sides = p + n;
+
+        uint64_t time = block.base_time_;
+        uint64_t id = block.base_id_;
+        int64_t price = block.base_price_;
+        const int64_t tick = header().tick_;
+        for (size_t i = 0; i < n; ++i) {
+            time += static_cast<uint64_t>(bitpack::unzigzag(times_[i]));
+            id += static_cast<uint64_t>(bitpack::unzigzag(ids_[i]));
+            price += bitpack::unzigzag(prices_[i]) * tick;
+            times_[i] = time;
+            ids_[i] = id;
+            prices_[i] = static_cast<uint64_t>(price);
+        }
+
+        for (size_t i = 0; i < n; ++i) {
+            const message msg(ids_[i], times_[i], static_cast<uint32_t>(sizes_[i]),
+                              static_cast<int32_t>(static_cast<int64_t>(prices_[i])),
+                              static_cast<char>(actions[i]), (sides[i / 8] >> (i % 8)) & 1);
+            fn(msg);
+        }
+        return n;
+    }
+};
+
+#endif //VECTOR_OB_COMPRESSED_FILE_H
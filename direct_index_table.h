@@ -0,0 +1,242 @@
+#ifndef VECTOR_OB_DIRECT_INDEX_TABLE_H
+#define VECTOR_OB_DIRECT_INDEX_TABLE_H
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include "lookup_table.h"
+
+// order id -> order* table for venues that hand out ids (mostly) in increasing order, same api as
+// OpenAddressTable. ids inside a sliding window of WINDOW_PAGES pages are stored directly at
+// slot id & PAGE_MASK of page id >> PAGE_BITS, so a lookup is a shift, a directory load and a slot load,
+// no hashing and no probing. pages are allocated the first time an id lands in them. when an id shows up
+// past the end of the window, the window slides forward and pages that fall behind it are retired,
+// any orders still resting on them move to the fallback OpenAddressTable, which also takes any id that
+// shows up behind the window. the window only slides up to MAX_SLIDE_PAGES past its end in one go, an id
+// further ahead than that is a stray (or the feed jumped) and goes to the fallback too, so one bad id
+// can't retire every live page and push the rest of the stream into the fallback. the window takes those
+// ids back once it slides over them, and an empty window jumps to any id
+template<typename OrderType>
+class DirectIndexTable {
+private:
+    static constexpr size_t PAGE_BITS = 12;
+    static constexpr size_t PAGE_SIZE = size_t(1) << PAGE_BITS;
+    static constexpr size_t PAGE_MASK = PAGE_SIZE - 1;
+    static constexpr size_t WINDOW_PAGES = 1024;
+    static constexpr size_t MAX_SLIDE_PAGES = WINDOW_PAGES;
+
+    struct Page {
+        OrderType* slots_[PAGE_SIZE];
+        uint64_t page_no_;
+        uint32_t live_;
+    };
+
+    std::vector<Page*> directory_;
+    std::vector<std::unique_ptr<Page>> pages_;
+    std::vector<Page*> free_pages_;
+    OpenAddressTable<OrderType> fallback_;
+    // ids that went to the fallback because they were too far ahead, moved into the window when it
+    // reaches them. ids erased since are dropped on the next slide
+    std::vector<uint64_t> ahead_;
+    uint64_t base_page_;
+    size_t direct_size_;
+    bool anchored_;
+
+    // until the first insert anchors it, the window sits at the very top of the page range so
+    // nothing is inside it
+    static constexpr uint64_t UNANCHORED_BASE = UINT64_MAX - WINDOW_PAGES + 1;
+
+    __attribute__((always_inline))
+    bool in_window(uint64_t page_no) const {
+        return page_no - base_page_ < WINDOW_PAGES;
+    }
+
+    Page* acquire_page(uint64_t page_no) {
+        Page* page;
+        if (free_pages_.empty()) {
+            pages_.push_back(std::make_unique<Page>());
+            page = pages_.back().get();
+            std::memset(page->slots_, 0, sizeof(page->slots_));
+        } else {
+            page = free_pages_.back();
+            free_pages_.pop_back();
+        }
+        page->page_no_ = page_no;
+        page->live_ = 0;
+        directory_[page_no & (WINDOW_PAGES - 1)] = page;
+        return page;
+    }
+
+    // moves whatever is still live on the page into the fallback table and recycles it
+    void retire_page(Page* page) {
+        for (size_t i = 0; page->live_ != 0 && i < PAGE_SIZE; ++i) {
+            if (page->slots_[i]) {
+                fallback_.insert((page->page_no_ << PAGE_BITS) | i, page->slots_[i]);
+                page->slots_[i] = nullptr;
+                --page->live_;
+                --direct_size_;
+            }
+        }
+        directory_[page->page_no_ & (WINDOW_PAGES - 1)] = nullptr;
+        free_pages_.push_back(page);
+    }
+
+    void slide_window(uint64_t page_no) {
+        uint64_t new_base = page_no - WINDOW_PAGES + 1;
+        for (Page*& page : directory_) {
+            if (page && page->page_no_ < new_base) {
+                retire_page(page);
+            }
+        }
+        base_page_ = new_base;
+        if (!ahead_.empty()) take_back_ahead();
+    }
+
+    // ids parked in the fallback for being too far ahead that the window now covers move into it
+    void take_back_ahead() {
+        size_t kept = 0;
+        for (uint64_t key : ahead_) {
+            // an empty window can jump past them, then they're behind it and stay in the fallback
+            if ((key >> PAGE_BITS) < base_page_) continue;
+            OrderType** val = fallback_.find(key);
+            if (!val) continue;
+            if (!in_window(key >> PAGE_BITS)) {
+                ahead_[kept++] = key;
+                continue;
+            }
+            insert_direct(key, *val);
+            fallback_.erase(key);
+        }
+        ahead_.resize(kept);
+    }
+
+    __attribute__((always_inline))
+    void insert_direct(uint64_t key, OrderType* val) {
+        uint64_t page_no = key >> PAGE_BITS;
+        Page* page = directory_[page_no & (WINDOW_PAGES - 1)];
+        if (__builtin_expect(!page, 0)) {
+            page = acquire_page(page_no);
+        }
+
+        OrderType*& slot = page->slots_[key & PAGE_MASK];
+        if (!slot) {
+            ++page->live_;
+            ++direct_size_;
+        }
+        slot = val;
+    }
+
+public:
+    explicit DirectIndexTable(size_t initial_size = 64)
+            : directory_(WINDOW_PAGES, nullptr)
+            , fallback_(initial_size)
+            , base_page_(UNANCHORED_BASE)
+            , direct_size_(0)
+            , anchored_(false) {}
+
+    DirectIndexTable(const DirectIndexTable&) = delete;
+    DirectIndexTable& operator=(const DirectIndexTable&) = delete;
+
+    __attribute__((always_inline))
+    bool insert(uint64_t key, OrderType* val) {
+        uint64_t page_no = key >> PAGE_BITS;
+
+        if (__builtin_expect(!in_window(page_no), 0)) {
+            if (!anchored_) {
+                base_page_ = page_no;
+                anchored_ = true;
+            } else if (page_no < base_page_) {
+                return fallback_.insert(key, val);
+            } else if (page_no - base_page_ >= WINDOW_PAGES + MAX_SLIDE_PAGES && direct_size_ != 0) {
+                ahead_.push_back(key);
+                return fallback_.insert(key, val);
+            } else {
+                slide_window(page_no);
+            }
+        }
+
+        insert_direct(key, val);
+        return true;
+    }
+
+    __attribute__((always_inline))
+    bool erase(uint64_t key) {
+        uint64_t page_no = key >> PAGE_BITS;
+        if (!in_window(page_no)) {
+            return fallback_.erase(key);
+        }
+
+        Page* page = directory_[page_no & (WINDOW_PAGES - 1)];
+        if (!page || !page->slots_[key & PAGE_MASK]) return false;
+
+        page->slots_[key & PAGE_MASK] = nullptr;
+        --page->live_;
+        --direct_size_;
+        return true;
+    }
+
+    __attribute__((always_inline))
+    const OrderType* const * find(uint64_t key) const {
+        uint64_t page_no = key >> PAGE_BITS;
+        if (__builtin_expect(!in_window(page_no), 0)) {
+            return fallback_.find(key);
+        }
+
+        const Page* page = directory_[page_no & (WINDOW_PAGES - 1)];
+        if (!page) return nullptr;
+        const OrderType* const * slot = &page->slots_[key & PAGE_MASK];
+        return *slot ? slot : nullptr;
+    }
+
+    __attribute__((always_inline))
+    OrderType** find(uint64_t key) {
+        return const_cast<OrderType**>(const_cast<const DirectIndexTable*>(this)->find(key));
+    }
+
+    __attribute__((always_inline))
+    size_t size() const { return direct_size_ + fallback_.size(); }
+
+    __attribute__((always_inline))
+    bool empty() const { return size() == 0; }
+
+    __attribute__((always_inline))
+    size_t capacity() const { return (pages_.size() - free_pages_.size()) * PAGE_SIZE + fallback_.capacity(); }
+
+    __attribute__((always_inline))
+    double load_factor() const {
+        return capacity() ? static_cast<double>(size()) / capacity() : 0.0;
+    }
+
+    size_t fallback_size() const { return fallback_.size(); }
+
+    void clear() {
+        for (Page*& page : directory_) {
+            if (page) {
+                std::memset(page->slots_, 0, sizeof(page->slots_));
+                free_pages_.push_back(page);
+                page = nullptr;
+            }
+        }
+        fallback_.clear();
+        ahead_.clear();
+        direct_size_ = 0;
+        base_page_ = UNANCHORED_BASE;
+        anchored_ = false;
+    }
+
+    // the window only ever needs a handful of pages, the fallback just holds stragglers
+    void reserve(size_t n) {
+        fallback_.reserve(n / 16);
+    }
+
+    // direct entries never probe, the rest is the fallback's histogram
+    std::vector<size_t> probe_histogram() const {
+        std::vector<size_t> histogram = fallback_.probe_histogram();
+        if (histogram.empty()) histogram.resize(1, 0);
+        histogram[0] += direct_size_;
+        return histogram;
+    }
+};
+
+#endif //VECTOR_OB_DIRECT_INDEX_TABLE_H
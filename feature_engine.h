@@ -0,0 +1,245 @@
+#ifndef VECTOR_OB_FEATURE_ENGINE_H
+#define VECTOR_OB_FEATURE_ENGINE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "book_level.h"
+
+// book features for research replays: microprice, spread, multi level imbalance, volume order imbalance
+// and a rolling trade vwap, sampled after every message or on a fixed exchange time grid. everything is
+// sized up front, the sample history and the vwap's trade window are rings that overwrite their oldest
+// entry, so the replay never allocates. works with any book that has get_top_levels<Side>(out, n)
+
+// most levels a side the imbalance can cover
+static constexpr size_t MAX_IMBALANCE_DEPTH = 64;
+
+struct FeatureOptions {
+    // exchange time between samples, 0 samples after every message. with an interval the first message at
+    // or past each multiple of it takes the sample
+    uint64_t sample_interval_ns = 0;
+    // levels a side the imbalance sums over, 1 is the top of book imbalance
+    size_t imbalance_depth = 5;
+    // trades ('T' messages) the vwap covers, by exchange time
+    uint64_t vwap_window_ns = 1000000000ULL;
+    // samples kept, rounded up to a power of two
+    size_t history = 1 << 16;
+    // trades the vwap window can hold, if a burst fills it the oldest leave the window early
+    size_t max_window_trades = 1 << 12;
+};
+
+struct FeatureSample {
+    uint64_t time_;
+    int32_t bid_price_;
+    int32_t ask_price_;
+    uint64_t bid_volume_;
+    uint64_t ask_volume_;
+    // ask - bid, in price units
+    int32_t spread_;
+    // trades in the vwap window
+    uint32_t window_trades_;
+    double mid_;
+    // mid weighted towards the side with less volume: (bid * ask_volume + ask * bid_volume) / (both volumes)
+    double microprice_;
+    // (bid volume - ask volume) / (bid volume + ask volume) over the best imbalance_depth levels a side
+    double imbalance_;
+    // volume order imbalance since the previous sample: new bid volume at the touch minus new ask volume,
+    // where a touch that moved in counts all its volume and one that moved away counts none
+    int64_t voi_;
+    // over the trades in the window, 0 when there weren't any
+    double vwap_;
+};
+
+// fixed capacity history that overwrites its oldest entry, index 0 is the oldest still kept
+template<typename T>
+class FeatureRing {
+public:
+    explicit FeatureRing(size_t capacity) {
+        size_t slots = 1;
+        while (slots < capacity) slots <<= 1;
+        slots_.resize(slots);
+        mask_ = slots - 1;
+    }
+
+    __attribute__((always_inline))
+    void push(const T& value) {
+        slots_[pushed_ & mask_] = value;
+        ++pushed_;
+    }
+
+    void clear() { pushed_ = 0; }
+
+    size_t size() const { return std::min<uint64_t>(pushed_, slots_.size()); }
+    size_t capacity() const { return slots_.size(); }
+    bool empty() const { return pushed_ == 0; }
+    // everything ever pushed, including what's been overwritten
+    uint64_t pushed() const { return pushed_; }
+
+    const T& operator[](size_t i) const { return slots_[(pushed_ - size() + i) & mask_]; }
+    const T& back() const { return slots_[(pushed_ - 1) & mask_]; }
+
+private:
+    std::vector<T> slots_;
+    uint64_t mask_ = 0;
+    uint64_t pushed_ = 0;
+};
+
+// wraps a book for replay like PublishedBook (top_of_book.h) and samples its features after process_msg
+template<typename Book>
+class FeatureEngine {
+public:
+    explicit FeatureEngine(Book& book, const FeatureOptions& options = {})
+            : book_(book), options_(options), samples_(options.history) {
+        options_.imbalance_depth = std::clamp<size_t>(options_.imbalance_depth, 1, MAX_IMBALANCE_DEPTH);
+        size_t slots = 1;
+        while (slots < options_.max_window_trades) slots <<= 1;
+        trades_.resize(slots);
+        trade_mask_ = slots - 1;
+    }
+
+    template<typename Msg>
+    __attribute__((always_inline))
+    void process_msg(const Msg& msg) {
+        book_.process_msg(msg);
+        if (msg.action() == 'T') add_trade(msg.time(), msg.price(), msg.size());
+        if (msg.time() >= next_sample_time_) sample(msg.time());
+    }
+
+    // every sample so far that hasn't been overwritten, oldest first
+    const FeatureRing<FeatureSample>& samples() const { return samples_; }
+    const FeatureOptions& options() const { return options_; }
+    Book& book() { return book_; }
+
+    // sampling points where one side of the book was empty, nothing is recorded for those
+    uint64_t one_sided() const { return one_sided_; }
+
+    // drops the history and the vwap window, the book is left alone
+    void reset() {
+        samples_.clear();
+        trade_head_ = 0;
+        trade_tail_ = 0;
+        notional_ = 0;
+        traded_ = 0;
+        next_sample_time_ = 0;
+        one_sided_ = 0;
+        has_previous_ = false;
+    }
+
+private:
+    struct Trade {
+        uint64_t time_;
+        int64_t notional_;
+        uint32_t size_;
+    };
+
+    Book& book_;
+    FeatureOptions options_;
+    FeatureRing<FeatureSample> samples_;
+    // the vwap window, trades trade_head_ up to trade_tail_ (counted since the start, masked into the ring)
+    std::vector<Trade> trades_;
+    uint64_t trade_mask_ = 0;
+    uint64_t trade_head_ = 0;
+    uint64_t trade_tail_ = 0;
+    // sums over the trades in the window, integers so adding and taking trades off never drifts
+    int64_t notional_ = 0;
+    uint64_t traded_ = 0;
+
+    uint64_t next_sample_time_ = 0;
+    uint64_t one_sided_ = 0;
+    // touch at the previous sample, for the voi
+    bool has_previous_ = false;
+    BookLevel previous_bid_{};
+    BookLevel previous_ask_{};
+
+    __attribute__((always_inline))
+    void add_trade(uint64_t time, int32_t price, uint32_t size) {
+        if (size == 0) return;
+        // a full window is about to overwrite its oldest trade, take it out of the sums first
+        if (trade_tail_ - trade_head_ == trades_.size()) drop_oldest_trade();
+        const int64_t notional = static_cast<int64_t>(price) * size;
+        trades_[trade_tail_++ & trade_mask_] = {time, notional, size};
+        notional_ += notional;
+        traded_ += size;
+    }
+
+    __attribute__((always_inline))
+    void drop_oldest_trade() {
+        const Trade& oldest = trades_[trade_head_++ & trade_mask_];
+        notional_ -= oldest.notional_;
+        traded_ -= oldest.size_;
+    }
+
+    __attribute__((always_inline))
+    void expire_trades(uint64_t now) {
+        const uint64_t cutoff = now > options_.vwap_window_ns ? now - options_.vwap_window_ns : 0;
+        while (trade_head_ != trade_tail_ && trades_[trade_head_ & trade_mask_].time_ < cutoff) {
+            drop_oldest_trade();
+        }
+    }
+
+    void sample(uint64_t time) {
+        if (options_.sample_interval_ns) {
+            next_sample_time_ = time - time % options_.sample_interval_ns + options_.sample_interval_ns;
+        }
+
+        BookLevel bids[MAX_IMBALANCE_DEPTH];
+        BookLevel asks[MAX_IMBALANCE_DEPTH];
+        const size_t bid_levels = book_.template get_top_levels<true>(bids, options_.imbalance_depth);
+        const size_t ask_levels = book_.template get_top_levels<false>(asks, options_.imbalance_depth);
+        if (bid_levels == 0 || ask_levels == 0) {
+            ++one_sided_;
+            has_previous_ = false;
+            return;
+        }
+
+        FeatureSample out;
+        out.time_ = time;
+        out.bid_price_ = bids[0].price_;
+        out.ask_price_ = asks[0].price_;
+        out.bid_volume_ = bids[0].volume_;
+        out.ask_volume_ = asks[0].volume_;
+        out.spread_ = out.ask_price_ - out.bid_price_;
+        out.mid_ = (static_cast<double>(out.bid_price_) + out.ask_price_) / 2;
+
+        const double touch_volume = static_cast<double>(out.bid_volume_) + out.ask_volume_;
+        out.microprice_ = touch_volume > 0
+                          ? (static_cast<double>(out.bid_price_) * out.ask_volume_
+                             + static_cast<double>(out.ask_price_) * out.bid_volume_) / touch_volume
+                          : out.mid_;
+
+        uint64_t bid_depth = 0;
+        uint64_t ask_depth = 0;
+        for (size_t i = 0; i < bid_levels; ++i) bid_depth += bids[i].volume_;
+        for (size_t i = 0; i < ask_levels; ++i) ask_depth += asks[i].volume_;
+        out.imbalance_ = bid_depth + ask_depth
+                         ? (static_cast<double>(bid_depth) - static_cast<double>(ask_depth)) / (bid_depth + ask_depth)
+                         : 0.0;
+
+        out.voi_ = 0;
+        if (has_previous_) {
+            out.voi_ = touch_change<true>(bids[0], previous_bid_) - touch_change<false>(asks[0], previous_ask_);
+        }
+        previous_bid_ = bids[0];
+        previous_ask_ = asks[0];
+        has_previous_ = true;
+
+        expire_trades(time);
+        out.window_trades_ = static_cast<uint32_t>(trade_tail_ - trade_head_);
+        out.vwap_ = traded_ ? static_cast<double>(notional_) / traded_ : 0.0;
+
+        samples_.push(out);
+    }
+
+    // volume that arrived at one side's touch since the previous sample
+    template<bool Side>
+    __attribute__((always_inline))
+    static int64_t touch_change(const BookLevel& now, const BookLevel& before) {
+        const bool improved = Side ? now.price_ > before.price_ : now.price_ < before.price_;
+        if (improved) return static_cast<int64_t>(now.volume_);
+        if (now.price_ == before.price_) return static_cast<int64_t>(now.volume_) - static_cast<int64_t>(before.volume_);
+        return 0;
+    }
+};
+
+#endif //VECTOR_OB_FEATURE_ENGINE_H
@@ -0,0 +1,71 @@
+#ifndef VECTOR_OB_HASH_POLICIES_H
+#define VECTOR_OB_HASH_POLICIES_H
+
+#include <cstddef>
+#include <cstdint>
+#include "xxhash/xxhash.h"
+
+// hash policies for the order id tables, each one is a struct with a static hash(uint64_t).
+// both tables take the slot from the low bits of the hash, SwissTable also takes its 7 bit
+// fingerprint from the lowest bits and the group from the bits above that
+
+// full xxh64 over the 8 key bytes, what the tables have always used
+struct XXHash {
+    __attribute__((always_inline))
+    static size_t hash(uint64_t key) {
+        return XXH64(&key, sizeof(key), 0);
+    }
+};
+
+// murmur3 64 bit finalizer, two multiplies and three xor-shifts, every input bit affects every output bit
+struct MurmurHash {
+    __attribute__((always_inline))
+    static size_t hash(uint64_t key) {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        key *= 0xc4ceb9fe1a85ec53ULL;
+        key ^= key >> 33;
+        return key;
+    }
+};
+
+// rustc's FxHasher on a single word, one multiply. the low bits only depend on the low bits of the key,
+// fine for ids that step by small odd amounts, bad if ids are multiples of a power of 2
+struct FxHash {
+    __attribute__((always_inline))
+    static size_t hash(uint64_t key) {
+        return key * 0x517cc1b727220a95ULL;
+    }
+};
+
+// wyhash's mum mix, 64x64->128 multiply and fold the halves together
+struct WyHash {
+    __attribute__((always_inline))
+    static size_t hash(uint64_t key) {
+        __uint128_t product = static_cast<__uint128_t>(key ^ 0xa0761d6478bd642fULL) * 0xe7037ed1a0b428dbULL;
+        return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+    }
+};
+
+// fibonacci hashing, multiply by 2^64 / golden ratio. the good bits of the product are the high ones,
+// so rotate them down to where the tables mask
+struct FibonacciHash {
+    __attribute__((always_inline))
+    static size_t hash(uint64_t key) {
+        uint64_t product = key * 0x9e3779b97f4a7c15ULL;
+        return (product >> 32) | (product << 32);
+    }
+};
+
+// the id itself, for exchange assigned ids that are close to sequential, consecutive ids land in
+// consecutive slots of OpenAddressTable. don't pair this with SwissTable, which would put every
+// run of 128 ids in the same group
+struct IdentityHash {
+    __attribute__((always_inline))
+    static size_t hash(uint64_t key) {
+        return key;
+    }
+};
+
+#endif //VECTOR_OB_HASH_POLICIES_H
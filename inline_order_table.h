@@ -0,0 +1,188 @@
+#ifndef VECTOR_OB_INLINE_ORDER_TABLE_H
+#define VECTOR_OB_INLINE_ORDER_TABLE_H
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "swiss_table.h"
+
+static constexpr uint32_t NULL_HANDLE = UINT32_MAX;
+
+// order that lives inside the lookup table, linked into its level's fifo queue by the 32 bit handles
+// (slot indexes) of its neighbours instead of pointers
+struct InlineOrder {
+    uint64_t id_;
+    uint64_t unix_time_;
+    int32_t price_;
+    uint32_t size_;
+    uint32_t next_;
+    uint32_t prev_;
+    bool side_;
+};
+
+// swiss table keyed by order id where the slot *is* the order, the control bytes are the same as
+// SwissTable's but the entry array holds InlineOrder and the key is the order's own id_. a cancel or
+// modify finds the order with one control group load plus one load of the slot it was looking for,
+// there's no second hop from the table into an order pool.
+// slots never move except when the table rehashes, so the slot index is a stable handle. when a rehash
+// does happen, next_/prev_ inside the orders are remapped here and the caller gets the old -> new
+// handle map to fix up anything else holding handles (level head/tail)
+template<typename Hash = XXHash>
+class InlineOrderTable {
+private:
+    std::vector<int8_t> ctrl_;
+    std::vector<InlineOrder> orders_;
+    size_t size_;
+    size_t tombstones_;
+    size_t group_mask_;
+
+    static constexpr size_t MIN_CAPACITY = 64;
+
+    __attribute__((always_inline))
+    static int8_t h2(size_t hash) { return static_cast<int8_t>(hash & 0x7F); }
+
+    __attribute__((always_inline))
+    size_t first_group(size_t hash) const { return (hash >> 7) & group_mask_; }
+
+    __attribute__((always_inline))
+    size_t next_group(size_t group, size_t probe) const { return (group + probe) & group_mask_; }
+
+    __attribute__((always_inline))
+    size_t find_insert_slot(size_t hash) const {
+        size_t group = first_group(hash);
+        for (size_t probe = 1; ; ++probe) {
+            const size_t base = group * swiss::GROUP_WIDTH;
+            auto free_slots = swiss::Group(&ctrl_[base]).match_empty_or_deleted();
+            if (free_slots) {
+                return base + free_slots.lowest();
+            }
+            group = next_group(group, probe);
+        }
+    }
+
+    void allocate(size_t capacity) {
+        ctrl_.assign(capacity, swiss::EMPTY);
+        orders_.assign(capacity, InlineOrder{});
+        group_mask_ = capacity / swiss::GROUP_WIDTH - 1;
+        size_ = 0;
+        tombstones_ = 0;
+    }
+
+    template<typename OnRehash>
+    void rehash(size_t new_capacity, OnRehash&& on_rehash) {
+        std::vector<int8_t> old_ctrl = std::move(ctrl_);
+        std::vector<InlineOrder> old_orders = std::move(orders_);
+        std::vector<uint32_t> remap(old_ctrl.size(), NULL_HANDLE);
+        allocate(new_capacity);
+
+        for (size_t i = 0; i < old_ctrl.size(); ++i) {
+            if (old_ctrl[i] >= 0) {
+                const size_t hash = Hash::hash(old_orders[i].id_);
+                size_t idx = find_insert_slot(hash);
+                ctrl_[idx] = h2(hash);
+                orders_[idx] = old_orders[i];
+                remap[i] = static_cast<uint32_t>(idx);
+                ++size_;
+            }
+        }
+
+        for (size_t i = 0; i < ctrl_.size(); ++i) {
+            if (ctrl_[i] >= 0) {
+                InlineOrder& order = orders_[i];
+                if (order.next_ != NULL_HANDLE) order.next_ = remap[order.next_];
+                if (order.prev_ != NULL_HANDLE) order.prev_ = remap[order.prev_];
+            }
+        }
+        on_rehash(remap);
+    }
+
+    static size_t capacity_for(size_t n) {
+        size_t target = MIN_CAPACITY;
+        while (target * 7 / 8 < n) target *= 2;
+        return target;
+    }
+
+public:
+    explicit InlineOrderTable(size_t initial_size = MIN_CAPACITY) {
+        allocate(capacity_for(initial_size));
+    }
+
+    __attribute__((always_inline))
+    uint32_t find(uint64_t id) const {
+        const size_t hash = Hash::hash(id);
+        const int8_t fingerprint = h2(hash);
+        size_t group = first_group(hash);
+
+        for (size_t probe = 1; ; ++probe) {
+            const size_t base = group * swiss::GROUP_WIDTH;
+            swiss::Group g(&ctrl_[base]);
+
+            for (auto match = g.match(fingerprint); match; match.clear_lowest()) {
+                size_t idx = base + match.lowest();
+                if (__builtin_expect(orders_[idx].id_ == id, 1)) {
+                    return static_cast<uint32_t>(idx);
+                }
+            }
+            if (g.match_empty()) {
+                return NULL_HANDLE;
+            }
+            group = next_group(group, probe);
+        }
+    }
+
+    // claims a slot for a new order id, which must not already be in the table. may rehash first,
+    // in which case every handle held outside the table has to go through the remap passed to on_rehash
+    template<typename OnRehash>
+    __attribute__((always_inline))
+    uint32_t insert(uint64_t id, OnRehash&& on_rehash) {
+        if (__builtin_expect((size_ + tombstones_ + 1) * 8 > ctrl_.size() * 7, 0)) {
+            rehash(size_ * 2 >= ctrl_.size() * 7 / 8 ? ctrl_.size() * 2 : ctrl_.size(), on_rehash);
+        }
+
+        const size_t hash = Hash::hash(id);
+        size_t idx = find_insert_slot(hash);
+        if (ctrl_[idx] == swiss::DELETED) --tombstones_;
+        ctrl_[idx] = h2(hash);
+        orders_[idx].id_ = id;
+        orders_[idx].next_ = NULL_HANDLE;
+        orders_[idx].prev_ = NULL_HANDLE;
+        ++size_;
+        return static_cast<uint32_t>(idx);
+    }
+
+    __attribute__((always_inline))
+    void erase(uint32_t handle) {
+        const size_t base = handle & ~(swiss::GROUP_WIDTH - 1);
+        if (swiss::Group(&ctrl_[base]).match_empty()) {
+            ctrl_[handle] = swiss::EMPTY;
+        } else {
+            ctrl_[handle] = swiss::DELETED;
+            ++tombstones_;
+        }
+        --size_;
+    }
+
+    __attribute__((always_inline))
+    InlineOrder& operator[](uint32_t handle) { return orders_[handle]; }
+
+    __attribute__((always_inline))
+    const InlineOrder& operator[](uint32_t handle) const { return orders_[handle]; }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    size_t capacity() const { return ctrl_.size(); }
+
+    // bytes held by the control and slot arrays
+    size_t memory_footprint() const {
+        return ctrl_.capacity() * sizeof(int8_t) + orders_.capacity() * sizeof(InlineOrder);
+    }
+
+    void clear() {
+        if (size_ == 0 && tombstones_ == 0) return;
+        std::memset(ctrl_.data(), static_cast<uint8_t>(swiss::EMPTY), ctrl_.size());
+        size_ = 0;
+        tombstones_ = 0;
+    }
+};
+
+#endif //VECTOR_OB_INLINE_ORDER_TABLE_H
@@ -0,0 +1,261 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "ladder_orderbook.cpp"
+#include "../inline_order_table.h"
+#include "../message.h"
+
+// price level for InlineLadder_Orderbook, a fifo of InlineOrder handles. orders find their level by price
+// through the ladder rather than a parent pointer, so there's nothing to relink when the ladder moves it
+struct InlineLimit {
+    int32_t price_ = 0;
+    uint32_t num_orders_ = 0;
+    uint64_t volume_ = 0;
+    uint32_t head_ = NULL_HANDLE;
+    uint32_t tail_ = NULL_HANDLE;
+    bool side_ = false;
+
+    bool is_empty() const { return head_ == NULL_HANDLE; }
+    void set(int32_t price) { price_ = price; }
+    void relink() {}
+};
+
+// the ladder book with its orders stored inline in the lookup table (InlineOrderTable), so there's no
+// order pool and no order* to chase after the lookup on the cancel/modify path
+class InlineLadder_Orderbook {
+private:
+    InlineOrderTable<> orders_;
+    PriceLadder<true, InlineLimit> bids_;
+    PriceLadder<false, InlineLimit> offers_;
+    uint64_t bid_count_;
+    uint64_t ask_count_;
+
+    static constexpr size_t INITIAL_LEVELS = 4096;
+    static constexpr size_t INITIAL_ORDERS = 1000000;
+
+    template<bool Side>
+    __attribute__((always_inline))
+    PriceLadder<Side, InlineLimit>& get_book_side() {
+        if constexpr (Side) {
+            return bids_;
+        } else {
+            return offers_;
+        }
+    }
+
+    __attribute__((always_inline))
+    void link(InlineLimit* level, uint32_t handle) {
+        InlineOrder& order = orders_[handle];
+        order.next_ = NULL_HANDLE;
+        order.prev_ = level->tail_;
+        if (level->tail_ != NULL_HANDLE) {
+            orders_[level->tail_].next_ = handle;
+        } else {
+            level->head_ = handle;
+        }
+        level->tail_ = handle;
+        level->volume_ += order.size_;
+        ++level->num_orders_;
+    }
+
+    __attribute__((always_inline))
+    void unlink(InlineLimit* level, uint32_t handle) {
+        InlineOrder& order = orders_[handle];
+        if (order.prev_ != NULL_HANDLE) {
+            orders_[order.prev_].next_ = order.next_;
+        } else {
+            level->head_ = order.next_;
+        }
+        if (order.next_ != NULL_HANDLE) {
+            orders_[order.next_].prev_ = order.prev_;
+        } else {
+            level->tail_ = order.prev_;
+        }
+        level->volume_ -= order.size_;
+        --level->num_orders_;
+    }
+
+    // Side is the side the order rests on, which isn't always the side the message says
+    template<bool Side>
+    __attribute__((always_inline))
+    void remove_resting(uint32_t handle) {
+        InlineLimit* level = get_book_side<Side>().find_limit(orders_[handle].price_);
+        unlink(level, handle);
+        if (level->is_empty()) {
+            get_book_side<Side>().on_level_emptied(level);
+        }
+        orders_.erase(handle);
+
+        if constexpr (Side) --bid_count_;
+        else --ask_count_;
+    }
+
+    // the table rehashed and moved every order, point the level queues at the new slots
+    void remap_levels(const std::vector<uint32_t>& remap) {
+        auto remap_level = [&remap](InlineLimit& level) {
+            level.head_ = remap[level.head_];
+            level.tail_ = remap[level.tail_];
+        };
+        bids_.for_each_level(remap_level);
+        offers_.for_each_level(remap_level);
+    }
+
+public:
+    explicit InlineLadder_Orderbook(int32_t tick_size = 1, size_t initial_orders = INITIAL_ORDERS)
+            : orders_(initial_orders)
+            , bids_(tick_size, INITIAL_LEVELS)
+            , offers_(tick_size, INITIAL_LEVELS)
+            , bid_count_(0)
+            , ask_count_(0) {}
+
+    template<bool Side>
+    __attribute__((always_inline))
+    void add_order(uint64_t id, int32_t price, uint32_t size, uint64_t unix_time) {
+        uint32_t handle = orders_.insert(id, [this](const std::vector<uint32_t>& remap) {
+            remap_levels(remap);
+        });
+        InlineOrder& order = orders_[handle];
+        order.price_ = price;
+        order.size_ = size;
+        order.side_ = Side;
+        order.unix_time_ = unix_time;
+
+        link(get_book_side<Side>().find_or_insert_limit(price), handle);
+
+        if constexpr (Side) {
+            ++bid_count_;
+        } else {
+            ++ask_count_;
+        }
+    }
+
+    // orders find their level by price, so the ladder has to be the order's own side, never the message's
+    template<bool Side>
+    __attribute__((always_inline))
+    void remove_order(uint64_t id, int32_t price, uint32_t size) {
+        uint32_t handle = orders_.find(id);
+        if (handle == NULL_HANDLE) return;
+
+        if (orders_[handle].side_) remove_resting<true>(handle);
+        else remove_resting<false>(handle);
+    }
+
+    template<bool Side>
+    __attribute__((always_inline))
+    void modify_order(uint64_t id, int32_t new_price, uint32_t new_size, uint64_t unix_time) {
+        uint32_t handle = orders_.find(id);
+        if (handle == NULL_HANDLE) {
+            add_order<Side>(id, new_price, new_size, unix_time);
+            return;
+        }
+
+        InlineOrder& order = orders_[handle];
+        if (order.side_ != Side) {
+            // changing side is a cancel and a new order
+            if (order.side_) remove_resting<true>(handle);
+            else remove_resting<false>(handle);
+            add_order<Side>(id, new_price, new_size, unix_time);
+            return;
+        }
+        InlineLimit* prev_level = get_book_side<Side>().find_limit(order.price_);
+
+        if (order.price_ != new_price) {
+            unlink(prev_level, handle);
+            if (prev_level->is_empty()) {
+                get_book_side<Side>().on_level_emptied(prev_level);
+            }
+            order.price_ = new_price;
+            order.size_ = new_size;
+            order.unix_time_ = unix_time;
+            link(get_book_side<Side>().find_or_insert_limit(new_price), handle);
+        } else if (order.size_ < new_size) {
+            unlink(prev_level, handle);
+            order.size_ = new_size;
+            order.unix_time_ = unix_time;
+            link(prev_level, handle);
+        } else {
+            prev_level->volume_ -= order.size_ - new_size;
+            order.size_ = new_size;
+            order.unix_time_ = unix_time;
+        }
+    }
+
+    template<bool Side>
+    __attribute__((always_inline))
+    void fill_order(uint64_t id, uint32_t fill_size) {
+        uint32_t handle = orders_.find(id);
+        if (handle == NULL_HANDLE) return;
+
+        InlineOrder& order = orders_[handle];
+        if (fill_size >= order.size_) {
+            remove_order<Side>(id, order.price_, order.size_);
+            return;
+        }
+        order.size_ -= fill_size;
+        if (order.side_) bids_.find_limit(order.price_)->volume_ -= fill_size;
+        else offers_.find_limit(order.price_)->volume_ -= fill_size;
+    }
+
+    // empties the book in one go, the table drops every order with one pass over its control bytes and
+    // the ladders only reset the levels their bitmaps say are occupied
+    void clear() {
+        orders_.clear();
+        bids_.clear();
+        offers_.clear();
+        bid_count_ = 0;
+        ask_count_ = 0;
+    }
+
+    // Msg is message or PackedMessageView (packed_message.h), anything with the same accessors
+    template<typename Msg>
+    __attribute__((always_inline))
+    inline void process_msg(const Msg& msg) {
+        switch (msg.action()) {
+            case 'A':
+                msg.side() ? add_order<true>(msg.id(), msg.price(), msg.size(), msg.time())
+                          : add_order<false>(msg.id(), msg.price(), msg.size(), msg.time());
+                break;
+            case 'C':
+                msg.side() ? remove_order<true>(msg.id(), msg.price(), msg.size())
+                          : remove_order<false>(msg.id(), msg.price(), msg.size());
+                break;
+            case 'M':
+                msg.side() ? modify_order<true>(msg.id(), msg.price(), msg.size(), msg.time())
+                          : modify_order<false>(msg.id(), msg.price(), msg.size(), msg.time());
+                break;
+            case 'F':
+                msg.side() ? fill_order<true>(msg.id(), msg.size())
+                          : fill_order<false>(msg.id(), msg.size());
+                break;
+            case 'R':
+                clear();
+                break;
+            case 'T':
+                break;
+        }
+    }
+
+    int32_t get_best_bid_price() const { return bids_.get_best_price(); }
+
+    int32_t get_best_ask_price() const { return offers_.get_best_price(); }
+
+    uint64_t get_best_bid_volume() const { return bids_.best_limit().volume_; }
+
+    uint64_t get_best_ask_volume() const { return offers_.best_limit().volume_; }
+
+    int32_t get_mid_price() const {
+        return (get_best_bid_price() + get_best_ask_price()) / 2;
+    }
+
+    // up to n levels of one side, best first, returns how many there were
+    template<bool Side>
+    size_t get_top_levels(BookLevel* out, size_t n) const {
+        if constexpr (Side) return bids_.top_levels(out, n);
+        else return offers_.top_levels(out, n);
+    }
+
+    uint64_t get_count() const { return bid_count_ + ask_count_; }
+
+    size_t memory_footprint() const { return orders_.memory_footprint(); }
+};
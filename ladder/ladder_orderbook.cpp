@@ -0,0 +1,481 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <map>
+#include <type_traits>
+#include <vector>
+#include "../lookup_table.h"
+#include "../swiss_table.h"
+#include "../direct_index_table.h"
+#include "level_bitmap.h"
+#include "../map/map_order.cpp"
+#include "../map/map_limit.cpp"
+#include "../map/map_order_pool.cpp"
+#include "../message.h"
+#include "../book_level.h"
+
+// one side of the book as a dense array of levels, slot i holds price base_ + i * tick_.
+// LevelType is MapLimit, or anything with the same price_/volume_/num_orders_/side_/is_empty()/set()
+// members and a relink() that repoints its orders at it after the ladder moves it.
+// the array grows up to MAX_LEVELS, a price that would need more than that, or that's off the tick grid,
+// gets its level in overflow_ instead, a map kept best first
+template<bool Side, typename LevelType = MapLimit>
+class PriceLadder {
+public:
+    static constexpr size_t MAX_LEVELS = 1 << 20;
+
+private:
+    using Overflow = std::map<int32_t, LevelType, std::conditional_t<Side, std::greater<int32_t>, std::less<int32_t>>>;
+
+    std::vector<LevelType> levels_;
+    LevelBitmap occupied_;
+    Overflow overflow_;
+    int64_t base_;
+    int32_t tick_;
+    size_t best_;
+    size_t active_levels_;
+
+    __attribute__((always_inline))
+    static bool is_better(size_t a, size_t b) {
+        if constexpr (Side) {
+            return a > b;
+        } else {
+            return a < b;
+        }
+    }
+
+    __attribute__((always_inline))
+    static bool is_better_price(int32_t a, int32_t b) {
+        if constexpr (Side) {
+            return a > b;
+        } else {
+            return a < b;
+        }
+    }
+
+    __attribute__((always_inline))
+    size_t index_of(int32_t price) const {
+        // prices below base_ wrap around to a huge offset and fail the bounds check,
+        // base_ starts at INT64_MAX so the first price always anchors the ladder.
+        // a price between two ticks fails it too rather than landing on its neighbour's slot
+        uint64_t offset = static_cast<uint64_t>(static_cast<int64_t>(price)) - static_cast<uint64_t>(base_);
+        uint64_t idx = offset / static_cast<uint64_t>(tick_);
+        if (__builtin_expect(offset != idx * static_cast<uint64_t>(tick_), 0)) return LevelBitmap::NONE;
+        return static_cast<size_t>(idx);
+    }
+
+    __attribute__((always_inline))
+    int32_t price_of(size_t idx) const {
+        return static_cast<int32_t>(base_ + static_cast<int64_t>(idx) * tick_);
+    }
+
+    // moves the array so it covers price, false if it can't: price is off the grid the resting levels are
+    // on, or they'd need more than MAX_LEVELS between them
+    bool recenter(int32_t price) {
+        const size_t old_size = levels_.size();
+
+        if (active_levels_ == 0) {
+            base_ = static_cast<int64_t>(price) - static_cast<int64_t>(old_size / 2) * tick_;
+            take_back_overflow();
+            return true;
+        }
+
+        if ((static_cast<int64_t>(price) - base_) % tick_ != 0) return false;
+
+        size_t lo_idx = occupied_.find_first();
+        size_t hi_idx = occupied_.find_last();
+
+        int64_t lo = std::min<int64_t>(price_of(lo_idx), price);
+        int64_t hi = std::max<int64_t>(price_of(hi_idx), price);
+        size_t span = static_cast<size_t>((hi - lo) / tick_) + 1;
+        if (span > MAX_LEVELS) return false;
+
+        // keep at least half the array as headroom so we don't recenter again on the next tick
+        size_t new_size = old_size;
+        while (span > new_size / 2 && new_size < MAX_LEVELS) new_size *= 2;
+        new_size = std::max(std::min(new_size, MAX_LEVELS), old_size);
+
+        int64_t new_base = lo - static_cast<int64_t>((new_size - span) / 2) * tick_;
+
+        std::vector<LevelType> new_levels(new_size, LevelType());
+        LevelBitmap new_occupied(new_size);
+        size_t new_best = 0;
+        for (size_t i = lo_idx; i != LevelBitmap::NONE; i = occupied_.find_next(i + 1)) {
+            size_t new_idx = static_cast<size_t>((price_of(i) - new_base) / tick_);
+            new_levels[new_idx] = levels_[i];
+            new_levels[new_idx].relink();
+            new_occupied.set(new_idx);
+            if (i == best_) new_best = new_idx;
+        }
+
+        levels_.swap(new_levels);
+        std::swap(occupied_, new_occupied);
+        base_ = new_base;
+        best_ = new_best;
+        take_back_overflow();
+        return true;
+    }
+
+    // overflow levels the array covers after a recenter move into it, a price only ever has one level
+    void take_back_overflow() {
+        for (auto it = overflow_.begin(); it != overflow_.end();) {
+            size_t idx = index_of(it->first);
+            if (idx >= levels_.size()) {
+                ++it;
+                continue;
+            }
+            levels_[idx] = it->second;
+            levels_[idx].relink();
+            occupied_.set(idx);
+            if (active_levels_ == 0 || is_better(idx, best_)) best_ = idx;
+            ++active_levels_;
+            it = overflow_.erase(it);
+        }
+    }
+
+    __attribute__((noinline))
+    LevelType* find_or_insert_outside(int32_t price) {
+        if (recenter(price)) {
+            size_t idx = index_of(price);
+            if (idx < levels_.size()) return insert_at(idx, price);
+        }
+        auto [it, inserted] = overflow_.try_emplace(price);
+        if (inserted) {
+            it->second.set(price);
+            it->second.side_ = Side;
+        }
+        return &it->second;
+    }
+
+    __attribute__((always_inline))
+    LevelType* insert_at(size_t idx, int32_t price) {
+        LevelType* limit = &levels_[idx];
+        if (limit->is_empty()) {
+            limit->set(price);
+            limit->side_ = Side;
+            occupied_.set(idx);
+            if (active_levels_ == 0 || is_better(idx, best_)) {
+                best_ = idx;
+            }
+            ++active_levels_;
+        }
+        return limit;
+    }
+
+public:
+    PriceLadder(int32_t tick_size, size_t num_levels)
+            : levels_(num_levels, LevelType())
+            , occupied_(num_levels)
+            , base_(std::numeric_limits<int64_t>::max())
+            , tick_(tick_size)
+            , best_(0)
+            , active_levels_(0)
+    {}
+
+    __attribute__((always_inline))
+    LevelType* find_or_insert_limit(int32_t price) {
+        size_t idx = index_of(price);
+        if (__builtin_expect(idx >= levels_.size(), 0)) {
+            return find_or_insert_outside(price);
+        }
+        return insert_at(idx, price);
+    }
+
+    // called after the last order has been unlinked from a level. the address is checked against the
+    // array as an integer before it's turned into an index, an overflow level lives in a map node and
+    // subtracting pointers into two different objects is undefined
+    __attribute__((always_inline))
+    void on_level_emptied(LevelType* limit) {
+        const uintptr_t offset = reinterpret_cast<uintptr_t>(limit) - reinterpret_cast<uintptr_t>(levels_.data());
+        if (__builtin_expect(offset >= levels_.size() * sizeof(LevelType), 0)) {
+            overflow_.erase(limit->price_);
+            return;
+        }
+        size_t idx = offset / sizeof(LevelType);
+        occupied_.reset(idx);
+        --active_levels_;
+
+        if (idx != best_ || active_levels_ == 0) return;
+
+        if constexpr (Side) {
+            best_ = occupied_.find_prev(idx);
+        } else {
+            best_ = occupied_.find_next(idx);
+        }
+    }
+
+    // drops every level, the next price re-anchors the ladder. only the occupied levels are touched
+    void clear() {
+        for (size_t i = occupied_.find_first(); i != LevelBitmap::NONE; i = occupied_.find_next(i + 1)) {
+            levels_[i] = LevelType();
+        }
+        occupied_.clear();
+        overflow_.clear();
+        base_ = std::numeric_limits<int64_t>::max();
+        best_ = 0;
+        active_levels_ = 0;
+    }
+
+    bool empty() const { return active_levels_ == 0 && overflow_.empty(); }
+    size_t level_count() const { return active_levels_ + overflow_.size(); }
+    size_t capacity() const { return levels_.size(); }
+    size_t overflow_count() const { return overflow_.size(); }
+
+    // level for a price that is already in the book, the caller has to know it is
+    __attribute__((always_inline))
+    LevelType* find_limit(int32_t price) {
+        size_t idx = index_of(price);
+        if (__builtin_expect(idx >= levels_.size(), 0)) {
+            auto it = overflow_.find(price);
+            assert(it != overflow_.end() && "find_limit on a price with no level");
+            return &it->second;
+        }
+        return &levels_[idx];
+    }
+
+    template<typename F>
+    void for_each_level(F&& f) {
+        for (size_t i = occupied_.find_first(); i != LevelBitmap::NONE; i = occupied_.find_next(i + 1)) {
+            f(levels_[i]);
+        }
+        for (auto& [price, level] : overflow_) f(level);
+    }
+
+    // up to n occupied levels from the touch outwards, best first
+    size_t top_levels(BookLevel* out, size_t n) const {
+        size_t count = 0;
+        size_t i = active_levels_ ? best_ : LevelBitmap::NONE;
+        auto stray = overflow_.begin();
+        for (; count < n; ++count) {
+            const bool dense = i != LevelBitmap::NONE;
+            if (!dense && stray == overflow_.end()) break;
+            if (dense && (stray == overflow_.end() || is_better_price(levels_[i].price_, stray->first))) {
+                out[count] = {levels_[i].price_, levels_[i].num_orders_, levels_[i].volume_};
+                if constexpr (Side) {
+                    i = i == 0 ? LevelBitmap::NONE : occupied_.find_prev(i - 1);
+                } else {
+                    i = occupied_.find_next(i + 1);
+                }
+            } else {
+                out[count] = {stray->second.price_, stray->second.num_orders_, stray->second.volume_};
+                ++stray;
+            }
+        }
+        return count;
+    }
+
+    const LevelType& best_limit() const {
+        if (__builtin_expect(overflow_.empty(), 1)) return levels_[best_];
+        const LevelType& stray = overflow_.begin()->second;
+        if (active_levels_ == 0 || is_better_price(stray.price_, levels_[best_].price_)) return stray;
+        return levels_[best_];
+    }
+    int32_t get_best_price() const { return best_limit().price_; }
+};
+
+// OrderTable is the order id -> MapOrder* index, OpenAddressTable, SwissTable or DirectIndexTable
+template<template<typename> class OrderTable = OpenAddressTable>
+class Ladder_Orderbook {
+private:
+    MapOrderPool order_pool_;
+    OrderTable<MapOrder> order_lookup_;
+    PriceLadder<true> bids_;
+    PriceLadder<false> offers_;
+    uint64_t bid_count_;
+    uint64_t ask_count_;
+
+    static constexpr size_t INITIAL_LEVELS = 4096;
+    static constexpr size_t INITIAL_ORDERS = 1000000;
+
+    template<bool Side>
+    __attribute__((always_inline))
+    PriceLadder<Side>& get_book_side() {
+        if constexpr (Side) {
+            return bids_;
+        } else {
+            return offers_;
+        }
+    }
+
+    // Side is the side the order rests on, which isn't always the side the message says
+    template<bool Side>
+    __attribute__((always_inline))
+    void remove_resting(MapOrder* target) {
+        auto curr_limit = target->parent_;
+        order_lookup_.erase(target->id_);
+        curr_limit->remove_order(target);
+
+        if (curr_limit->is_empty()) {
+            get_book_side<Side>().on_level_emptied(curr_limit);
+        }
+
+        if constexpr (Side) --bid_count_;
+        else --ask_count_;
+
+        order_pool_.return_order(target);
+    }
+
+public:
+    explicit Ladder_Orderbook(int32_t tick_size = 1, size_t initial_orders = INITIAL_ORDERS)
+            : order_pool_(initial_orders)
+            , bids_(tick_size, INITIAL_LEVELS)
+            , offers_(tick_size, INITIAL_LEVELS)
+            , bid_count_(0)
+            , ask_count_(0) {
+        order_lookup_.reserve(initial_orders);
+    }
+
+    template<bool Side>
+    __attribute__((always_inline))
+    void add_order(uint64_t id, int32_t price, uint32_t size, uint64_t unix_time) {
+        MapOrder* new_order = order_pool_.get_order();
+        new_order->id_ = id;
+        new_order->price_ = price;
+        new_order->size = size;
+        new_order->side_ = Side;
+        new_order->unix_time_ = unix_time;
+
+        MapLimit* curr_limit = get_book_side<Side>().find_or_insert_limit(price);
+        order_lookup_.insert(id, new_order);
+        curr_limit->add_order(new_order);
+
+        if constexpr (Side) {
+            ++bid_count_;
+        } else {
+            ++ask_count_;
+        }
+    }
+
+    // the level and the counters come from the order, a cancel or fill carrying the other side would
+    // otherwise hand one ladder a level that lives in the other
+    template<bool Side>
+    __attribute__((always_inline))
+    void remove_order(uint64_t id, int32_t price, uint32_t size) {
+        auto** target_ptr = order_lookup_.find(id);
+        if (!target_ptr) return;
+
+        auto target = *target_ptr;
+        if (target->side_) remove_resting<true>(target);
+        else remove_resting<false>(target);
+    }
+
+    template<bool Side>
+    __attribute__((always_inline))
+    void modify_order(uint64_t id, int32_t new_price, uint32_t new_size, uint64_t unix_time) {
+        auto** target_ptr = order_lookup_.find(id);
+        if (!target_ptr) {
+            add_order<Side>(id, new_price, new_size, unix_time);
+            return;
+        }
+
+        auto target = *target_ptr;
+        if (target->side_ != Side) {
+            // changing side is a cancel and a new order
+            if (target->side_) remove_resting<true>(target);
+            else remove_resting<false>(target);
+            add_order<Side>(id, new_price, new_size, unix_time);
+            return;
+        }
+        auto prev_limit = target->parent_;
+
+        if (target->price_ != new_price) {
+            prev_limit->remove_order(target);
+            if (prev_limit->is_empty()) {
+                get_book_side<Side>().on_level_emptied(prev_limit);
+            }
+            MapLimit* new_limit = get_book_side<Side>().find_or_insert_limit(new_price);
+            target->size = new_size;
+            target->price_ = new_price;
+            target->unix_time_ = unix_time;
+            new_limit->add_order(target);
+        } else if (target->size < new_size) {
+            prev_limit->remove_order(target);
+            target->size = new_size;
+            target->unix_time_ = unix_time;
+            prev_limit->add_order(target);
+        } else {
+            prev_limit->volume_ -= target->size - new_size;
+            target->size = new_size;
+            target->unix_time_ = unix_time;
+        }
+    }
+
+    template<bool Side>
+    __attribute__((always_inline))
+    void fill_order(uint64_t id, uint32_t fill_size) {
+        auto** target_ptr = order_lookup_.find(id);
+        if (!target_ptr) return;
+
+        auto target = *target_ptr;
+        if (fill_size >= target->size) {
+            remove_order<Side>(id, target->price_, target->size);
+            return;
+        }
+        target->size -= fill_size;
+        target->parent_->volume_ -= fill_size;
+    }
+
+    // empties the book in one go, the order pool takes every order back at once and the ladders only
+    // reset the levels their bitmaps say are occupied
+    void clear() {
+        bids_.clear();
+        offers_.clear();
+        order_lookup_.clear();
+        order_pool_.reset();
+        bid_count_ = 0;
+        ask_count_ = 0;
+    }
+
+    // Msg is message or PackedMessageView (packed_message.h), anything with the same accessors
+    template<typename Msg>
+    __attribute__((always_inline))
+    inline void process_msg(const Msg& msg) {
+        switch (msg.action()) {
+            case 'A':
+                msg.side() ? add_order<true>(msg.id(), msg.price(), msg.size(), msg.time())
+                          : add_order<false>(msg.id(), msg.price(), msg.size(), msg.time());
+                break;
+            case 'C':
+                msg.side() ? remove_order<true>(msg.id(), msg.price(), msg.size())
+                          : remove_order<false>(msg.id(), msg.price(), msg.size());
+                break;
+            case 'M':
+                msg.side() ? modify_order<true>(msg.id(), msg.price(), msg.size(), msg.time())
+                          : modify_order<false>(msg.id(), msg.price(), msg.size(), msg.time());
+                break;
+            case 'F':
+                msg.side() ? fill_order<true>(msg.id(), msg.size())
+                          : fill_order<false>(msg.id(), msg.size());
+                break;
+            case 'R':
+                clear();
+                break;
+            case 'T':
+                break;
+        }
+    }
+
+    int32_t get_best_bid_price() const { return bids_.get_best_price(); }
+
+    int32_t get_best_ask_price() const { return offers_.get_best_price(); }
+
+    uint64_t get_best_bid_volume() const { return bids_.best_limit().volume_; }
+
+    uint64_t get_best_ask_volume() const { return offers_.best_limit().volume_; }
+
+    int32_t get_mid_price() const {
+        return (get_best_bid_price() + get_best_ask_price()) / 2;
+    }
+
+    // up to n levels of one side, best first, returns how many there were
+    template<bool Side>
+    size_t get_top_levels(BookLevel* out, size_t n) const {
+        if constexpr (Side) return bids_.top_levels(out, n);
+        else return offers_.top_levels(out, n);
+    }
+
+    uint64_t get_count() const { return bid_count_ + ask_count_; }
+};
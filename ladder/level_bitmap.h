@@ -0,0 +1,124 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// three level occupancy bitset over price slots, bit i of the bottom level is set when slot i
+// holds a non-empty limit, each bit of the level above is set when the 64 bit word below it is non-zero.
+// finding the next/previous occupied slot is at most one word per level plus a ctz/clz, regardless
+// of how far away that slot is
+class LevelBitmap {
+public:
+    static constexpr size_t NONE = static_cast<size_t>(-1);
+
+    explicit LevelBitmap(size_t num_slots = 0) { resize(num_slots); }
+
+    void resize(size_t num_slots) {
+        num_slots_ = num_slots;
+        l0_.assign(words_for(num_slots), 0);
+        l1_.assign(words_for(l0_.size()), 0);
+        l2_.assign(words_for(l1_.size()), 0);
+    }
+
+    void clear() {
+        std::fill(l0_.begin(), l0_.end(), 0);
+        std::fill(l1_.begin(), l1_.end(), 0);
+        std::fill(l2_.begin(), l2_.end(), 0);
+    }
+
+    __attribute__((always_inline))
+    bool test(size_t slot) const {
+        return (l0_[slot >> 6] >> (slot & 63)) & 1;
+    }
+
+    __attribute__((always_inline))
+    void set(size_t slot) {
+        size_t w0 = slot >> 6;
+        size_t w1 = w0 >> 6;
+        l0_[w0] |= bit(slot);
+        l1_[w1] |= bit(w0);
+        l2_[w1 >> 6] |= bit(w1);
+    }
+
+    __attribute__((always_inline))
+    void reset(size_t slot) {
+        size_t w0 = slot >> 6;
+        l0_[w0] &= ~bit(slot);
+        if (l0_[w0] != 0) return;
+
+        size_t w1 = w0 >> 6;
+        l1_[w1] &= ~bit(w0);
+        if (l1_[w1] != 0) return;
+
+        l2_[w1 >> 6] &= ~bit(w1);
+    }
+
+    // lowest occupied slot >= slot, NONE if there isn't one
+    __attribute__((always_inline))
+    size_t find_next(size_t slot) const {
+        if (slot >= num_slots_) return NONE;
+
+        size_t w0 = slot >> 6;
+        uint64_t word = l0_[w0] & (~0ULL << (slot & 63));
+        if (word) return (w0 << 6) | __builtin_ctzll(word);
+
+        size_t w1 = w0 >> 6;
+        word = (w0 & 63) == 63 ? 0 : l1_[w1] & (~0ULL << ((w0 & 63) + 1));
+        if (!word) {
+            size_t w2 = w1 >> 6;
+            uint64_t top = (w1 & 63) == 63 ? 0 : l2_[w2] & (~0ULL << ((w1 & 63) + 1));
+            while (!top) {
+                if (++w2 >= l2_.size()) return NONE;
+                top = l2_[w2];
+            }
+            w1 = (w2 << 6) | __builtin_ctzll(top);
+            word = l1_[w1];
+        }
+        w0 = (w1 << 6) | __builtin_ctzll(word);
+        return (w0 << 6) | __builtin_ctzll(l0_[w0]);
+    }
+
+    // highest occupied slot <= slot, NONE if there isn't one
+    __attribute__((always_inline))
+    size_t find_prev(size_t slot) const {
+        if (num_slots_ == 0) return NONE;
+        if (slot >= num_slots_) slot = num_slots_ - 1;
+
+        size_t w0 = slot >> 6;
+        uint64_t word = l0_[w0] & (~0ULL >> (63 - (slot & 63)));
+        if (word) return (w0 << 6) | (63 - __builtin_clzll(word));
+
+        size_t w1 = w0 >> 6;
+        word = (w0 & 63) == 0 ? 0 : l1_[w1] & (~0ULL >> (64 - (w0 & 63)));
+        if (!word) {
+            size_t w2 = w1 >> 6;
+            uint64_t top = (w1 & 63) == 0 ? 0 : l2_[w2] & (~0ULL >> (64 - (w1 & 63)));
+            while (!top) {
+                if (w2-- == 0) return NONE;
+                top = l2_[w2];
+            }
+            w1 = (w2 << 6) | (63 - __builtin_clzll(top));
+            word = l1_[w1];
+        }
+        w0 = (w1 << 6) | (63 - __builtin_clzll(word));
+        return (w0 << 6) | (63 - __builtin_clzll(l0_[w0]));
+    }
+
+    size_t find_first() const { return find_next(0); }
+    size_t find_last() const { return find_prev(num_slots_ - 1); }
+
+    size_t size() const { return num_slots_; }
+
+private:
+    std::vector<uint64_t> l0_;
+    std::vector<uint64_t> l1_;
+    std::vector<uint64_t> l2_;
+    size_t num_slots_ = 0;
+
+    __attribute__((always_inline))
+    static uint64_t bit(size_t i) { return 1ULL << (i & 63); }
+
+    static size_t words_for(size_t bits) { return bits == 0 ? 1 : (bits + 63) / 64; }
+};
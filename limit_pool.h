@@ -0,0 +1,76 @@
+#ifndef VECTOR_OB_LIMIT_POOL_H
+#define VECTOR_OB_LIMIT_POOL_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// recycles price level objects, limits are built in chunks and never destroyed until the pool goes away,
+// so a level that empties and comes back at the touch costs a free list pop and a reset() instead of
+// a new/delete (and for Vector_Limit, keeps the capacity its orders_ vector already grew to)
+template<typename LimitType>
+class LimitPool {
+private:
+    std::vector<std::unique_ptr<LimitType[]>> chunks_;
+    std::vector<LimitType*> available_limits_;
+    size_t chunk_size_;
+    size_t live_;
+    size_t peak_;
+
+    void add_chunk() {
+        chunks_.push_back(std::make_unique<LimitType[]>(chunk_size_));
+        LimitType* chunk = chunks_.back().get();
+        available_limits_.reserve(available_limits_.size() + chunk_size_);
+        // push in reverse so limits come back out in address order
+        for (size_t i = chunk_size_; i > 0; --i) {
+            available_limits_.push_back(&chunk[i - 1]);
+        }
+    }
+
+public:
+    explicit LimitPool(size_t initial_size)
+            : chunk_size_(initial_size ? initial_size : 1)
+            , live_(0)
+            , peak_(0) {
+        add_chunk();
+    }
+
+    LimitPool(const LimitPool&) = delete;
+    LimitPool& operator=(const LimitPool&) = delete;
+
+    __attribute__((always_inline))
+    LimitType* get_limit() {
+        if (__builtin_expect(available_limits_.empty(), 0)) {
+            add_chunk();
+        }
+        LimitType* limit = available_limits_.back();
+        available_limits_.pop_back();
+        limit->reset();
+        if (++live_ > peak_) peak_ = live_;
+        return limit;
+    }
+
+    __attribute__((always_inline))
+    void return_limit(LimitType* limit) {
+        available_limits_.push_back(limit);
+        --live_;
+    }
+
+    // takes every limit back at once, for a book clear. anything still holding a limit is invalid afterwards
+    void reset() {
+        available_limits_.clear();
+        for (size_t c = chunks_.size(); c > 0; --c) {
+            LimitType* chunk = chunks_[c - 1].get();
+            for (size_t i = chunk_size_; i > 0; --i) {
+                available_limits_.push_back(&chunk[i - 1]);
+            }
+        }
+        live_ = 0;
+    }
+
+    size_t live() const { return live_; }
+    size_t peak() const { return peak_; }
+    size_t capacity() const { return chunks_.size() * chunk_size_; }
+};
+
+#endif //VECTOR_OB_LIMIT_POOL_H
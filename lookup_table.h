@@ -2,10 +2,11 @@
 #define VECTOR_OB_LOOKUP_TABLE_H
 
 #include <vector>
-#include "xxhash/xxhash.h"
+#include "hash_policies.h"
 
-template<typename OrderType>
-class OpenAddressTable {
+// robin hood open addressing table from order id to order*, Hash is one of the policies in hash_policies.h
+template<typename OrderType, typename Hash>
+class BasicOpenAddressTable {
 private:
     struct alignas(16) Entry {
         uint64_t key_;
@@ -54,14 +55,15 @@ private:
     static constexpr size_t PREFETCH_DISTANCE = 4;
 
 public:
-    explicit OpenAddressTable(size_t initial_size = 64) : size_(0) {
+    explicit BasicOpenAddressTable(size_t initial_size = 64) : size_(0) {
         size_t actual_size = 1;
         while (actual_size < initial_size) actual_size *= 2;
         data_.resize(actual_size);
     }
 
+    __attribute__((always_inline))
     static size_t hash_key(uint64_t key) {
-        return XXH64(&key, sizeof(key), 0);
+        return Hash::hash(key);
     }
 
     __attribute__((always_inline))
@@ -90,9 +92,16 @@ public:
             }
 
             if (probe_dist > data_[pos].probe_dist_) {
-                std::swap(key, data_[pos].key_);
-                std::swap(val, data_[pos].val_);
-                std::swap(probe_dist, data_[pos].probe_dist_);
+                // fields are packed, so swap through temporaries rather than binding references
+                uint64_t displaced_key = data_[pos].key_;
+                OrderType* displaced_val = data_[pos].val_;
+                uint16_t displaced_dist = data_[pos].probe_dist_;
+                data_[pos].key_ = key;
+                data_[pos].val_ = val;
+                data_[pos].probe_dist_ = probe_dist;
+                key = displaced_key;
+                val = displaced_val;
+                probe_dist = displaced_dist;
                 data_[pos].status_ = 2;
             }
 
@@ -171,7 +180,7 @@ public:
 
     __attribute__((always_inline))
     OrderType** find(uint64_t key) {
-        return const_cast<OrderType**>(const_cast<const OpenAddressTable*>(this)->find(key));
+        return const_cast<OrderType**>(const_cast<const BasicOpenAddressTable*>(this)->find(key));
     }
 
 private:
@@ -190,37 +199,21 @@ private:
     }
 
     void resize() {
-        size_t new_size = data_.size() * 2;
-        std::vector<Entry> new_data(new_size);
-
-        for (const auto& entry : data_) {
-            if (entry.status_ == 2) {
-                size_t pos = hash_key(entry.key_) & (new_size - 1);
-                size_t probe_dist = 0;
-
-                while (true) {
-                    if (new_data[pos].status_ == 0) {
-                        new_data[pos] = Entry{entry.key_, entry.val_,
-                                              static_cast<uint16_t>(probe_dist), 2};
-                        break;
-                    }
+        rehash(data_.size() * 2);
+    }
 
-                    if (probe_dist > new_data[pos].probe_dist_) {
-                        Entry tmp(std::move(new_data[pos]));
-                        new_data[pos] = Entry{entry.key_, entry.val_,
-                                              static_cast<uint16_t>(probe_dist), 2};
-                        tmp.probe_dist_ = static_cast<uint16_t>(probe_dist + 1);
-                        pos = next_probe_position(pos);
-                        continue;
-                    }
+    // reinserts everything through insert() so displaced entries keep the robin hood ordering
+    // that find() and erase() rely on to stop early
+    void rehash(size_t new_size) {
+        std::vector<Entry> old_data(new_size);
+        old_data.swap(data_);
+        size_ = 0;
 
-                    pos = next_probe_position(pos);
-                    ++probe_dist;
-                }
+        for (auto& entry : old_data) {
+            if (entry.status_ == 2) {
+                insert(entry.key_, entry.val_);
             }
         }
-
-        data_ = std::move(new_data);
     }
 
 public:
@@ -238,38 +231,38 @@ public:
         return static_cast<double>(size_) / data_.size();
     }
 
+    // keeps the capacity, a book clearing mid session is about to fill the table back up
     void clear() {
-        data_.clear();
-        data_.resize(64);
+        if (size_ == 0) return;
+        for (auto& entry : data_) {
+            entry.status_ = 0;
+            entry.val_ = nullptr;
+        }
         size_ = 0;
     }
 
+    // number of entries at each probe distance from their home slot
+    std::vector<size_t> probe_histogram() const {
+        std::vector<size_t> histogram;
+        for (const auto& entry : data_) {
+            if (entry.status_ != 2) continue;
+            if (entry.probe_dist_ >= histogram.size()) histogram.resize(entry.probe_dist_ + 1, 0);
+            ++histogram[entry.probe_dist_];
+        }
+        return histogram;
+    }
+
     void reserve(size_t n) {
         size_t target_size = 1;
         while (target_size < n) target_size *= 2;
 
         if (target_size > data_.size()) {
-            std::vector<Entry> new_data(target_size);
-
-            for (auto& entry : data_) {
-                if (entry.status_ == 2) {
-                    size_t pos = hash_key(entry.key_) & (target_size - 1);
-                    size_t probe_dist = 0;
-
-                    while (true) {
-                        if (new_data[pos].status_ == 0) {
-                            new_data[pos] = Entry{entry.key_, entry.val_,
-                                                  static_cast<uint16_t>(probe_dist), 2};
-                            break;
-                        }
-                        pos = next_probe_position(pos);
-                        ++probe_dist;
-                    }
-                }
-            }
-            data_ = std::move(new_data);
+            rehash(target_size);
         }
     }
 };
 
+template<typename OrderType>
+using OpenAddressTable = BasicOpenAddressTable<OrderType, XXHash>;
+
 #endif //VECTOR_OB_LOOKUP_TABLE_H
\ No newline at end of file
@@ -1,94 +1,318 @@
-#include <chrono>
 #include <vector>
 #include <algorithm>
+#include <charconv>
 #include <numeric>
 #include <iostream>
 #include <iomanip>
 #include <thread>
-#include <mach/mach_time.h>
+#include "platform.h"
 #include "vector/orderbook.cpp"
 #include "parser.cpp"
+#include "pipeline.h"
+#include "message_file.h"
+#include "compressed_file.h"
+#include "book_manager.h"
+#include "sharded_replay.h"
+#include "shm_feed.h"
 #include "map/map_orderbook.cpp"
+#include "ladder/ladder_orderbook.cpp"
+#include "ladder/inline_ladder_orderbook.cpp"
 
-using namespace std::chrono;
+struct ReplayOptions {
+    size_t parse_threads = 1;
+    // feed the book straight from the parser instead of parsing the whole file first
+    bool stream = false;
+    // parse on one thread and update the book on another, connected by a ring
+    bool pipeline = false;
+    PipelineOptions pipeline_options;
+    // the csv has a 7th instrument_id column, replay it into one book per instrument
+    bool instruments = false;
+    // with instruments, replay on this many worker threads (sharded_replay.h), 0 replays on this thread
+    size_t shards = 0;
+    // shm name to publish the book's changes on (shm_feed.h), empty for none
+    std::string publish;
+    // levels a side to publish level updates for, 0 publishes top of book only
+    uint32_t publish_depth = 0;
+    // price increment the ladder books index their levels by, prices off it still work but go in the
+    // ladder's overflow map
+    int32_t tick_size = 1;
+};
 
-void process_vector_orderbook(const std::string& filepath) {
-    Parser parser(filepath);
-    Vector_Orderbook orderbook;
-
-    auto parse_start = high_resolution_clock::now();
-    parser.parse();
-    auto parse_end = high_resolution_clock::now();
-    auto parse_duration = duration_cast<milliseconds>(parse_end - parse_start);
+// books in a BookManager start small and grow, a product complex is hundreds of mostly quiet instruments
+static constexpr size_t ORDERS_PER_INSTRUMENT = 1 << 14;
+static constexpr size_t LEVELS_PER_INSTRUMENT = 64;
 
-    std::cout << "Parsed " << parser.get_message_count() << " messages in "
-              << parse_duration.count() << "ms\n";
+static void print_rate(const char* verb, size_t messages, uint64_t ns, size_t bytes) {
+    double mb_per_s = ns ? bytes / 1e6 / (ns / 1e9) : 0.0;
+    std::cout << verb << " " << messages << " messages in " << ns / 1000000 << "ms ("
+              << std::fixed << std::setprecision(1) << mb_per_s << " MB/s";
+    std::cout.unsetf(std::ios::fixed);
+}
 
-    auto process_start = high_resolution_clock::now();
-    size_t msg_count = parser.get_message_count();
+// parses the file, then replays message_stream_ through the book. in stream mode the parser hands the
+// book each batch as soon as it's parsed, so the one timing covers both, in pipeline mode the parser and
+// the book run on their own threads at the same time. a binary message file (see tools/csv_to_bin.cpp) is
+// mapped and replayed in place whatever the options
+template<typename Book>
+void replay_messages(MessageSpan messages, Book& orderbook) {
+    platform::Stopwatch process_timer;
 
-    for (size_t i = 0; i < msg_count; ++i) {
-        const auto& msg = parser.message_stream_[i];
+    for (const auto& msg : messages) {
         orderbook.process_msg(msg);
+    }
+
+    uint64_t process_ms = process_timer.elapsed_ms();
 
+    std::cout << "Total processing time: " << process_ms << "ms\n";
+}
 
+template<typename Book>
+void replay(const std::string& filepath, Book& orderbook, const ReplayOptions& options) {
+    if (MessageFile::is_message_file(filepath)) {
+        // already parsed by csv_to_bin, the book reads the records straight out of the mapping
+        platform::Stopwatch map_timer;
+        MessageFile file(filepath);
+        MessageSpan messages = file.messages();
+        std::cout << "Mapped " << messages.size() << " " << file.symbol() << " messages in "
+                  << map_timer.elapsed_ns() / 1000 << "us\n";
+        replay_messages(messages, orderbook);
+        return;
     }
 
-    auto process_end = high_resolution_clock::now();
-    auto process_duration = duration_cast<milliseconds>(process_end - process_start);
+    if (CompressedMessageFile::is_compressed_file(filepath)) {
+        platform::Stopwatch decode_timer;
+        CompressedMessageFile file(filepath);
+        size_t msg_count = file.for_each([&orderbook](const message& msg) {
+            orderbook.process_msg(msg);
+        });
+        print_rate("Decoded", msg_count, decode_timer.elapsed_ns(), file.get_file_size());
+        std::cout << ", " << file.block_count() << " blocks of " << file.symbol() << ")\n";
+        return;
+    }
+
+    Parser parser(filepath);
 
-    std::cout << "Total processing time: " << process_duration.count() << "ms\n";
+    if (options.pipeline) {
+        PipelineStats stats = run_pipeline(parser, orderbook, options.pipeline_options);
+        print_rate("Pipelined", stats.messages_, stats.elapsed_ns_, parser.get_file_size());
+        std::cout << std::fixed << std::setprecision(2) << ", " << stats.messages_ / (stats.elapsed_ns_ / 1e9) / 1e6
+                  << "M msgs/s)\n";
+        std::cout << "Ring occupancy (" << stats.capacity_ << " slots): mean "
+                  << stats.mean_occupancy() * 100 << "%, p50 <= " << stats.occupancy_percentile(0.5) * 100
+                  << "%, p99 <= " << stats.occupancy_percentile(0.99) * 100 << "%\n";
+        std::cout.unsetf(std::ios::fixed);
+        std::cout << "Parser stalls (ring full): " << stats.parser_stalls_
+                  << ", book idle spins (ring empty): " << stats.book_idle_ << "\n";
+        if (!stats.parser_pinned_ || !stats.book_pinned_) {
+            std::cout << "warning: could not pin " << (stats.parser_pinned_ ? "book" : "parser") << " thread\n";
+        }
+        return;
+    }
 
+    if (options.stream) {
+        platform::Stopwatch stream_timer;
+        size_t msg_count = parser.stream([&orderbook](const message& msg) {
+            orderbook.process_msg(msg);
+        });
+        print_rate("Streamed", msg_count, stream_timer.elapsed_ns(), parser.get_file_size());
+        std::cout << ")\n";
+        return;
+    }
+
+    platform::Stopwatch parse_timer;
+    parser.parse(ParseMode::simd, options.parse_threads);
+    print_rate("Parsed", parser.get_message_count(), parse_timer.elapsed_ns(), parser.get_file_size());
+    std::cout << ", " << options.parse_threads << (options.parse_threads == 1 ? " thread" : " threads") << ")\n";
+
+    replay_messages(MessageSpan(parser.message_stream_), orderbook);
 }
 
-void process_map_orderbook(const std::string& filepath) {
-    Parser parser(filepath);
-    Orderbook map_orderbook;
+// with --publish the book is wrapped in a FeedBook, so every top of book change (and level change within
+// publish_depth) goes out on the shared memory feed for tools/feed_tail.cpp or anything else to read
+template<typename Book>
+void replay_book(const std::string& filepath, Book& orderbook, const ReplayOptions& options) {
+    if (options.publish.empty()) {
+        replay(filepath, orderbook, options);
+        return;
+    }
+
+    FeedPublisher feed(options.publish, 1 << 16, options.publish_depth);
+    FeedBook<Book> published(orderbook, feed);
+    replay(filepath, published, options);
+    const uint64_t updates = feed.published();
+    feed.finish();
+    std::cout << "Published " << updates << " updates to " << feed.name() << "\n";
+}
+
+template<template<typename> class OrderTable>
+void process_vector_orderbook(const std::string& filepath, const ReplayOptions& options) {
+    Vector_Orderbook<OrderTable> orderbook;
+    replay_book(filepath, orderbook, options);
+    std::cout << "Live levels: " << orderbook.get_live_levels()
+              << ", peak levels: " << orderbook.get_peak_levels() << "\n";
+}
+
+template<template<typename> class OrderTable>
+void process_map_orderbook(const std::string& filepath, const ReplayOptions& options) {
+    Orderbook<OrderTable> map_orderbook;
+    replay_book(filepath, map_orderbook, options);
+    std::cout << "Live levels: " << map_orderbook.get_live_levels()
+              << ", peak levels: " << map_orderbook.get_peak_levels() << "\n";
+}
 
-    auto parse_start = high_resolution_clock::now();
-    parser.parse();
-    auto parse_end = high_resolution_clock::now();
-    auto parse_duration = duration_cast<milliseconds>(parse_end - parse_start);
+template<template<typename> class OrderTable>
+void process_ladder_orderbook(const std::string& filepath, const ReplayOptions& options) {
+    Ladder_Orderbook<OrderTable> ladder_orderbook(options.tick_size);
+    replay_book(filepath, ladder_orderbook, options);
+}
 
-    std::cout << "Parsed " << parser.get_message_count() << " messages in "
-              << parse_duration.count() << "ms\n";
+void process_inline_ladder_orderbook(const std::string& filepath, const ReplayOptions& options) {
+    InlineLadder_Orderbook ladder_orderbook(options.tick_size);
+    replay_book(filepath, ladder_orderbook, options);
+}
 
-    auto process_start = high_resolution_clock::now();
-    size_t msg_count = parser.get_message_count();
+// parses a multi instrument csv, gives the instruments local ids and replays everything through a
+// BookManager, book_args are what each instrument's book is constructed with
+template<typename Book, typename... BookArgs>
+void process_instruments(const std::string& filepath, const ReplayOptions& options, BookArgs... book_args) {
+    BookManager<Book> manager([book_args...] { return std::make_unique<Book>(book_args...); });
+    Parser parser(filepath);
+    std::vector<InstrumentMessage> messages;
 
-    for (size_t i = 0; i < msg_count; ++i) {
-        const auto &msg = parser.message_stream_[i];
-        map_orderbook.process_msg(msg);
+    platform::Stopwatch parse_timer;
+    parser.parse_instruments_into(messages);
+    manager.localize(messages);
+    print_rate("Parsed", messages.size(), parse_timer.elapsed_ns(), parser.get_file_size());
+    std::cout << ", " << manager.size() << " instruments)\n";
 
+    if (options.shards) {
+        ShardedOptions sharded_options;
+        sharded_options.shards = options.shards;
+        ShardedStats stats = run_sharded(messages, manager, sharded_options);
+        std::cout << "Total processing time: " << stats.elapsed_ns_ / 1000000 << "ms on " << options.shards
+                  << " shards (" << std::fixed << std::setprecision(2) << stats.imbalance()
+                  << "x busiest shard over the mean, " << stats.dispatcher_stalls_ << " dispatcher stalls)\n";
+        std::cout.unsetf(std::ios::fixed);
+    } else {
+        platform::Stopwatch process_timer;
+        for (const auto& msg : messages) {
+            manager.process_msg(msg);
+        }
+        std::cout << "Total processing time: " << process_timer.elapsed_ms() << "ms\n";
     }
 
-    auto process_end = high_resolution_clock::now();
-    auto process_duration = duration_cast<milliseconds>(process_end - process_start);
+    uint64_t resting = 0;
+    manager.for_each_book([&resting](uint32_t, Book& book) { resting += book.get_count(); });
+    std::cout << "Resting orders across instruments: " << resting << "\n";
+}
 
-    std::cout << "Total processing time: " << process_duration.count() << "ms\n";
+template<template<typename> class OrderTable>
+bool process_orderbook(const std::string& filepath, const std::string& orderbook_type, const ReplayOptions& options) {
+    if (orderbook_type == "vector") {
+        if (options.instruments) {
+            process_instruments<Vector_Orderbook<OrderTable>>(filepath, options, ORDERS_PER_INSTRUMENT, LEVELS_PER_INSTRUMENT);
+        } else {
+            process_vector_orderbook<OrderTable>(filepath, options);
+        }
+    }
+    else if (orderbook_type == "map") {
+        if (options.instruments) {
+            process_instruments<Orderbook<OrderTable>>(filepath, options, ORDERS_PER_INSTRUMENT);
+        } else {
+            process_map_orderbook<OrderTable>(filepath, options);
+        }
+    }
+    else if (orderbook_type == "ladder") {
+        if (options.instruments) {
+            process_instruments<Ladder_Orderbook<OrderTable>>(filepath, options, options.tick_size, ORDERS_PER_INSTRUMENT);
+        } else {
+            process_ladder_orderbook<OrderTable>(filepath, options);
+        }
+    }
+    else if (orderbook_type == "ladder_inline") {
+        // stores its orders in its own InlineOrderTable, order_table doesn't apply
+        if (options.instruments) {
+            process_instruments<InlineLadder_Orderbook>(filepath, options, options.tick_size, ORDERS_PER_INSTRUMENT);
+        } else {
+            process_inline_ladder_orderbook(filepath, options);
+        }
+    }
+    else {
+        std::cerr << "Invalid orderbook type. Use 'vector', 'map', 'ladder' or 'ladder_inline'\n";
+        return false;
+    }
+    return true;
+}
+
+// the whole of text as a number that fits in out, so "x", "4x", "-1" for a count or an out of range value
+// fail instead of throwing out of stoul or wrapping
+template<typename T>
+bool parse_number(const std::string& text, T& out) {
+    const char* end = text.data() + text.size();
+    auto [ptr, ec] = std::from_chars(text.data(), end, out);
+    return ec == std::errc() && ptr == end && !text.empty();
 }
 
 int main(int argc, char* argv[]) {
-    if (argc != 3) {
-        std::cerr << "Usage: " << argv[0] << " <input_file> <orderbook_type>\n";
-        std::cerr << "orderbook_type: 'vector' or 'map'\n";
+    ReplayOptions options;
+    std::vector<std::string> args;
+    std::string bad_arg;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool ok = true;
+        if (arg == "--stream") options.stream = true;
+        else if (arg == "--pipeline") options.pipeline = true;
+        else if (arg == "--instruments") options.instruments = true;
+        else if (arg.rfind("--shards=", 0) == 0) ok = parse_number(arg.substr(9), options.shards);
+        else if (arg.rfind("--publish=", 0) == 0) options.publish = arg.substr(10);
+        else if (arg.rfind("--publish-depth=", 0) == 0) ok = parse_number(arg.substr(16), options.publish_depth);
+        else if (arg.rfind("--parser-cpu=", 0) == 0) ok = parse_number(arg.substr(13), options.pipeline_options.parser_cpu);
+        else if (arg.rfind("--book-cpu=", 0) == 0) ok = parse_number(arg.substr(11), options.pipeline_options.book_cpu);
+        else if (arg.rfind("--tick=", 0) == 0) ok = parse_number(arg.substr(7), options.tick_size) && options.tick_size > 0;
+        else args.push_back(arg);
+        if (!ok && bad_arg.empty()) bad_arg = arg;
+    }
+    if (args.size() == 4 && !parse_number(args[3], options.parse_threads) && bad_arg.empty()) bad_arg = args[3];
+
+    if (!bad_arg.empty()) std::cerr << "Invalid value: " << bad_arg << "\n";
+    if (args.size() < 2 || args.size() > 4 || (options.instruments && !options.publish.empty()) || !bad_arg.empty()) {
+        std::cerr << "Usage: " << argv[0] << " <input_file|message_file|compressed_file> <orderbook_type> [order_table] [parse_threads] [--stream]\n"
+                  << "       [--pipeline [--parser-cpu=N] [--book-cpu=N]] [--instruments [--shards=N]]\n"
+                  << "       [--publish=/shm_name [--publish-depth=N]] [--tick=N]\n";
+        std::cerr << "orderbook_type: 'vector', 'map', 'ladder' or 'ladder_inline'\n";
+        std::cerr << "order_table: 'robin_hood' (default), 'swiss' or 'direct'\n";
+        std::cerr << "parse_threads: threads to parse the file with, default 1, 0 for all cores\n";
+        std::cerr << "--stream: replay while parsing in fixed size batches, memory stays flat (parse_threads is ignored)\n";
+        std::cerr << "--pipeline: stream on a parser thread into a ring drained by a book thread, optionally pinned\n";
+        std::cerr << "--instruments: csv with a 7th instrument_id column, one book per instrument (single threaded parse),\n"
+                  << "               --shards=N replays the instruments on N worker threads fed by a dispatcher thread\n";
+        std::cerr << "--publish: publish top of book changes to a shared memory feed for tools/feed_tail.cpp, with\n"
+                  << "           --publish-depth=N also every level change in the best N a side (single instrument only)\n";
+        std::cerr << "--tick: price increment for the ladder books, default 1\n";
         return 1;
     }
 
-    std::string filepath = argv[1];
-    std::string orderbook_type = argv[2];
+    std::string filepath = args[0];
+    std::string orderbook_type = args[1];
+    std::string order_table = args.size() >= 3 ? args[2] : "robin_hood";
+    if (options.parse_threads == 0) options.parse_threads = std::max(1u, std::thread::hardware_concurrency());
 
     try {
-        if (orderbook_type == "vector") {
-            process_vector_orderbook(filepath);
+        bool ok;
+        if (order_table == "robin_hood") {
+            ok = process_orderbook<OpenAddressTable>(filepath, orderbook_type, options);
         }
-        else if (orderbook_type == "map") {
-            process_map_orderbook(filepath);
+        else if (order_table == "swiss") {
+            ok = process_orderbook<SwissTable>(filepath, orderbook_type, options);
+        }
+        else if (order_table == "direct") {
+            ok = process_orderbook<DirectIndexTable>(filepath, orderbook_type, options);
         }
         else {
-            std::cerr << "Invalid orderbook type. Use 'vector' or 'map'\n";
+            std::cerr << "Invalid order table. Use 'robin_hood', 'swiss' or 'direct'\n";
             return 1;
         }
+        if (!ok) return 1;
     }
     catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
@@ -96,4 +320,4 @@ int main(int argc, char* argv[]) {
     }
 
     return 0;
-}
\ No newline at end of file
+}
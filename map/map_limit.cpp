@@ -5,6 +5,8 @@
 
 class MapLimit {
 public:
+    MapLimit() : MapLimit(0) {}
+
     explicit MapLimit(int32_t price)
             : price_(price)
             , volume_(0)
@@ -84,6 +86,13 @@ public:
 
     void set(int32_t price) { price_ = price; }
 
+    // points every resting order back at this level, for when the level object itself has moved
+    void relink() {
+        for (MapOrder* order = head_; order; order = order->next_) {
+            order->parent_ = this;
+        }
+    }
+
     int32_t price_;
     uint64_t volume_;
     uint32_t num_orders_;
@@ -4,13 +4,16 @@
 #include <map>
 #include <unordered_map>
 #include <boost/functional/hash.hpp>
-#include <arm_neon.h>
 #include <chrono>
 #include "../lookup_table.h"
+#include "../swiss_table.h"
+#include "../direct_index_table.h"
 #include "map_order.cpp"
 #include "map_limit.cpp"
 #include "map_order_pool.cpp"
+#include "../limit_pool.h"
 #include "../message.h"
+#include "../book_level.h"
 
 
 template<bool Side>
@@ -26,9 +29,12 @@ struct MapBookSide<false> {
     using MapType = std::map<int32_t, MapLimit*, std::less<>>;
 };
 
+// OrderTable is the order id -> MapOrder* index, OpenAddressTable, SwissTable or DirectIndexTable
+template<template<typename> class OrderTable = OpenAddressTable>
 class Orderbook {
 private:
     MapOrderPool order_pool_;
+    LimitPool<MapLimit> limit_pool_;
     std::unordered_map<std::pair<int32_t, bool>, MapLimit*, boost::hash<std::pair<int32_t, bool>>> limit_lookup_;
     uint64_t bid_count_;
     uint64_t ask_count_;
@@ -36,6 +42,19 @@ private:
     static constexpr size_t BUFFER_SIZE = 40000;
     size_t write_index_ = 0;
 
+    // running volume of the best VOLUME_DEPTH levels a side. boundary_ is the worst level still inside that
+    // window, end() while the side has fewer levels than that. a volume change only has to be compared
+    // against the boundary's price, and a level coming or going inside the window pushes exactly one
+    // level, the boundary, out or pulls its neighbour in, so keeping it up to date never walks the map
+    template<bool Side>
+    struct DepthWindow {
+        typename MapBookSide<Side>::MapType::iterator boundary_;
+        uint64_t volume_ = 0;
+    };
+
+    DepthWindow<true> bid_window_;
+    DepthWindow<false> ask_window_;
+
     template<bool Side>
     __attribute__((always_inline))
     typename MapBookSide<Side>::MapType& get_book_side() {
@@ -46,45 +65,104 @@ private:
         }
     }
 
+    template<bool Side>
+    __attribute__((always_inline))
+    DepthWindow<Side>& get_window() {
+        if constexpr (Side) {
+            return bid_window_;
+        } else {
+            return ask_window_;
+        }
+    }
+
+    // at or better than the boundary, or the side is shallow enough to be all window
+    template<bool Side>
+    __attribute__((always_inline))
+    bool in_window(int32_t price) {
+        auto& levels = get_book_side<Side>();
+        auto& window = get_window<Side>();
+        return window.boundary_ == levels.end() || !levels.key_comp()(window.boundary_->first, price);
+    }
+
+    // delta is signed, the unsigned wraparound comes out right
+    template<bool Side>
+    __attribute__((always_inline))
+    void update_window_volume(int32_t price, int64_t delta) {
+        if (in_window<Side>(price)) get_window<Side>().volume_ += delta;
+    }
+
     template<bool Side>
     __attribute__((always_inline))
     MapLimit* get_or_insert_limit(int32_t price) {
         auto key = std::make_pair(price, Side);
         auto it = limit_lookup_.find(key);
         if (it == limit_lookup_.end()) {
-            auto* new_limit = new MapLimit(price);
-            get_book_side<Side>()[price] = new_limit;
+            auto* new_limit = limit_pool_.get_limit();
+            new_limit->set(price);
+            auto& levels = get_book_side<Side>();
+            auto level = levels.emplace(price, new_limit).first;
             new_limit->side_ = Side;
             limit_lookup_[key] = new_limit;
+
+            // the new level is empty, if it lands inside a full window the old boundary drops out
+            auto& window = get_window<Side>();
+            if (levels.size() == VOLUME_DEPTH) {
+                window.boundary_ = std::prev(levels.end());
+            } else if (levels.size() > VOLUME_DEPTH && levels.key_comp()(level->first, window.boundary_->first)) {
+                window.volume_ -= window.boundary_->second->volume_;
+                --window.boundary_;
+            }
             return new_limit;
         }
         return it->second;
     }
 
+    // limit has to be empty. if it was inside a full window the level after the boundary moves in
+    template<bool Side>
+    __attribute__((always_inline))
+    void erase_limit(MapLimit* limit) {
+        const int32_t price = limit->price_;
+        auto& levels = get_book_side<Side>();
+        auto& window = get_window<Side>();
+        if (levels.size() <= VOLUME_DEPTH) {
+            window.boundary_ = levels.end();
+        } else if (!levels.key_comp()(window.boundary_->first, price)) {
+            ++window.boundary_;
+            window.volume_ += window.boundary_->second->volume_;
+        }
+        levels.erase(price);
+        limit_lookup_.erase(std::make_pair(price, Side));
+        limit_pool_.return_limit(limit);
+    }
+
 public:
+    // levels a side calculate_vols() covers
+    static constexpr size_t VOLUME_DEPTH = 100;
+
     MapBookSide<true>::MapType bids_;
     MapBookSide<false>::MapType offers_;
-    OpenAddressTable<MapOrder> order_lookup_;
+    OrderTable<MapOrder> order_lookup_;
     std::chrono::system_clock::time_point current_message_time_;
 
     double vwap_, sum1_, sum2_;
     float skew_, bid_depth_, ask_depth_;
-    int32_t bid_vol_, ask_vol_;
+    uint64_t bid_vol_, ask_vol_;
     double imbalance_;
     std::vector<int32_t> voi_history_;
     std::vector<int32_t> mid_prices_;
 
-    Orderbook() : order_pool_(1000000), bid_count_(0), ask_count_(0) {
+    explicit Orderbook(size_t initial_orders = 1000000)
+            : order_pool_(initial_orders), limit_pool_(2000), bid_count_(0), ask_count_(0) {
         bids_.get_allocator().allocate(1000);
         offers_.get_allocator().allocate(1000);
-        order_lookup_.reserve(1000000);
+        order_lookup_.reserve(initial_orders);
         limit_lookup_.reserve(2000);
         voi_history_.reserve(40000);
+        bid_window_.boundary_ = bids_.end();
+        ask_window_.boundary_ = offers_.end();
     }
 
     ~Orderbook() {
-        for (auto& pair : bids_) delete pair.second;
-        for (auto& pair : offers_) delete pair.second;
         bids_.clear();
         offers_.clear();
         order_lookup_.clear();
@@ -104,6 +182,7 @@ public:
         MapLimit* curr_limit = get_or_insert_limit<Side>(price);
         order_lookup_.insert(id, new_order);
         curr_limit->add_order(new_order);
+        update_window_volume<Side>(price, size);
 
         if constexpr (Side) {
             ++bid_count_;
@@ -114,14 +193,22 @@ public:
 
     template<bool Side>
     void remove_order(uint64_t id, int32_t price, uint32_t size) {
-        auto target = *order_lookup_.find(id);
+        auto** target_ptr = order_lookup_.find(id);
+        if (!target_ptr) return;
+
+        auto target = *target_ptr;
+        // a message with the wrong side would otherwise take the level out of the wrong map and window
+        if (target->side_ != Side) {
+            remove_order<!Side>(id, price, size);
+            return;
+        }
         auto curr_limit = target->parent_;
         order_lookup_.erase(id);
+        update_window_volume<Side>(curr_limit->price_, -static_cast<int64_t>(target->size));
         curr_limit->remove_order(target);
 
         if (curr_limit->is_empty()) {
-            get_book_side<Side>().erase(price);
-            limit_lookup_.erase(std::make_pair(price, Side));
+            erase_limit<Side>(curr_limit);
             target->parent_ = nullptr;
         }
 
@@ -136,31 +223,42 @@ public:
         auto** target_ptr = order_lookup_.find(id);
         if (!target_ptr) {
             add_limit_order<Side>(id, new_price, new_size, unix_time);
+            return;
         }
 
         auto target = *target_ptr;
+        if (target->side_ != Side) {
+            // changing side is a cancel and a new order
+            remove_order<!Side>(id, target->price_, target->size);
+            add_limit_order<Side>(id, new_price, new_size, unix_time);
+            return;
+        }
         auto prev_price = target->price_;
         auto prev_limit = target->parent_;
         auto prev_size = target->size;
 
         if (prev_price != new_price) {
+            update_window_volume<Side>(prev_price, -static_cast<int64_t>(prev_size));
             prev_limit->remove_order(target);
             if (prev_limit->is_empty()) {
-                get_book_side<Side>().erase(prev_price);
-                std::pair<int32_t, bool> key = std::make_pair(prev_price, Side);
-                limit_lookup_.erase(key);
+                erase_limit<Side>(prev_limit);
             }
             MapLimit* new_limit = get_or_insert_limit<Side>(new_price);
             target->size = new_size;
             target->price_ = new_price;
             target->unix_time_ = unix_time;
             new_limit->add_order(target);
+            update_window_volume<Side>(new_price, new_size);
         } else if (prev_size < new_size) {
             prev_limit->remove_order(target);
             target->size = new_size;
             target->unix_time_ = unix_time;
             prev_limit->add_order(target);
+            update_window_volume<Side>(prev_price, new_size - prev_size);
         } else {
+            // keeps its place in the queue, only the level's volume moves
+            prev_limit->volume_ -= prev_size - new_size;
+            update_window_volume<Side>(prev_price, -static_cast<int64_t>(prev_size - new_size));
             target->size = new_size;
             target->unix_time_ = unix_time;
         }
@@ -168,37 +266,45 @@ public:
         //update_modify_vol<Side>(prev_price, new_price, prev_size, new_size);
     }
 
-
+    template<bool Side>
     __attribute__((always_inline))
-    inline void calculate_vols() {
-        uint32x4_t bid_vol_vec = vdupq_n_u32(0);
-        uint32x4_t ask_vol_vec = vdupq_n_u32(0);
-
-        auto bid_it = bids_.begin();
-        auto bid_end = bids_.end();
-        auto ask_it = offers_.begin();
-        auto ask_end = offers_.end();
-
-        for (int i = 0; i < 100 && (bid_it != bid_end || ask_it != ask_end); i += 4) {
-            uint32_t bid_chunk[4] = {0};
-            uint32_t ask_chunk[4] = {0};
-
-            for (int j = 0; j < 4; ++j) {
-                if (bid_it != bid_end) {
-                    bid_chunk[j] = bid_it->second->volume_;
-                    ++bid_it;
-                }
-                if (ask_it != ask_end) {
-                    ask_chunk[j] = ask_it->second->volume_;
-                    ++ask_it;
-                }
-            }
-            bid_vol_vec = vaddq_u32(bid_vol_vec, vld1q_u32(bid_chunk));
-            ask_vol_vec = vaddq_u32(ask_vol_vec, vld1q_u32(ask_chunk));
+    void fill_order(uint64_t id, uint32_t fill_size) {
+        auto** target_ptr = order_lookup_.find(id);
+        if (!target_ptr) return;
+
+        auto target = *target_ptr;
+        if (fill_size >= target->size) {
+            remove_order<Side>(id, target->price_, target->size);
+            return;
         }
+        target->size -= fill_size;
+        target->parent_->volume_ -= fill_size;
+        // the order's own side, in case the message has the wrong one
+        target->side_ ? update_window_volume<true>(target->price_, -static_cast<int64_t>(fill_size))
+                      : update_window_volume<false>(target->price_, -static_cast<int64_t>(fill_size));
+    }
 
-        bid_vol_ = vaddvq_u32(bid_vol_vec);
-        ask_vol_ = vaddvq_u32(ask_vol_vec);
+    // empties the book in one go, the pools take every order and level back at once instead of one
+    // remove_order at a time
+    void clear() {
+        bids_.clear();
+        offers_.clear();
+        limit_lookup_.clear();
+        order_lookup_.clear();
+        order_pool_.reset();
+        limit_pool_.reset();
+        bid_count_ = 0;
+        ask_count_ = 0;
+        bid_window_ = {bids_.end(), 0};
+        ask_window_ = {offers_.end(), 0};
+    }
+
+
+    // O(1), the windows are kept up to date by every add, cancel, modify and fill
+    __attribute__((always_inline))
+    inline void calculate_vols() {
+        bid_vol_ = bid_window_.volume_;
+        ask_vol_ = ask_window_.volume_;
     }
 
     __attribute__((always_inline))
@@ -219,24 +325,34 @@ public:
     }
 
 
-    inline void process_msg(const message &msg) {
-        auto nanoseconds = std::chrono::nanoseconds(msg.time_);
+    // Msg is message or PackedMessageView (packed_message.h), anything with the same accessors
+    template<typename Msg>
+    inline void process_msg(const Msg &msg) {
+        auto nanoseconds = std::chrono::nanoseconds(msg.time());
         auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(nanoseconds);
         current_message_time_ = std::chrono::system_clock::time_point(microseconds);
-        switch (msg.action_) {
+        switch (msg.action()) {
             case 'A':
-                msg.side_ ? add_limit_order<true>(msg.id_, msg.price_, msg.size_, msg.time_)
-                          : add_limit_order<false>(msg.id_, msg.price_, msg.size_, msg.time_);
+                msg.side() ? add_limit_order<true>(msg.id(), msg.price(), msg.size(), msg.time())
+                          : add_limit_order<false>(msg.id(), msg.price(), msg.size(), msg.time());
                 break;
             case 'C':
-                msg.side_ ? remove_order<true>(msg.id_, msg.price_, msg.size_)
-                          : remove_order<false>(msg.id_, msg.price_, msg.size_);
+                msg.side() ? remove_order<true>(msg.id(), msg.price(), msg.size())
+                          : remove_order<false>(msg.id(), msg.price(), msg.size());
                 break;
             case 'M':
-                msg.side_ ? modify_order<true>(msg.id_, msg.price_, msg.size_, msg.time_)
-                          : modify_order<false>(msg.id_, msg.price_, msg.size_, msg.time_);
+                msg.side() ? modify_order<true>(msg.id(), msg.price(), msg.size(), msg.time())
+                          : modify_order<false>(msg.id(), msg.price(), msg.size(), msg.time());
+                break;
+            case 'F':
+                msg.side() ? fill_order<true>(msg.id(), msg.size())
+                          : fill_order<false>(msg.id(), msg.size());
+                break;
+            case 'R':
+                clear();
+                break;
+            case 'T':
                 break;
-
         }
 
     }
@@ -252,5 +368,30 @@ public:
         return (get_best_bid_price() + get_best_ask_price()) / 2;
     }
 
+    // up to n levels of one side, best first, returns how many there were
+    template<bool Side>
+    size_t get_top_levels(BookLevel* out, size_t n) const {
+        size_t count = 0;
+        auto copy = [out, n, &count](const auto& levels) {
+            for (auto it = levels.begin(); it != levels.end() && count < n; ++it, ++count) {
+                out[count] = {it->first, it->second->num_orders_, it->second->volume_};
+            }
+        };
+        if constexpr (Side) copy(bids_);
+        else copy(offers_);
+        return count;
+    }
+
+    // volume resting in the best VOLUME_DEPTH levels of one side
+    template<bool Side>
+    uint64_t get_depth_volume() const {
+        if constexpr (Side) return bid_window_.volume_;
+        else return ask_window_.volume_;
+    }
+
     uint64_t get_count() const { return bid_count_ + ask_count_; }
+
+    size_t get_live_levels() const { return limit_pool_.live(); }
+
+    size_t get_peak_levels() const { return limit_pool_.peak(); }
 };
\ No newline at end of file
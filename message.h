@@ -1,17 +1,75 @@
 
 #ifndef DATABENTO_ORDERBOOK_MESSAGE_H
 #define DATABENTO_ORDERBOOK_MESSAGE_H
+#include <cstddef>
 #include <cstdint>
+#include <vector>
 struct message {
     uint64_t id_;
     uint64_t time_;
     uint32_t size_;
     int32_t price_;
+    // A add, M modify, C cancel, R clear the book. F fills a resting order, taking size off it where it sits
+    // in the queue, and the last of it removes the order. T prints the aggressor, which never rests, so the
+    // books ignore it, the resting side it hit arrives as F
     char action_;
     bool side_;
 
+    message() = default;
+
     message(uint64_t id, uint64_t time, uint32_t size, int32_t price, char action, bool side)
             : id_(id), time_(time), size_(size), price_(price), action_(action), side_(side) {}
+
+    // the books read messages through these so they can take PackedMessageView (packed_message.h) too
+    uint64_t id() const { return id_; }
+    uint64_t time() const { return time_; }
+    uint32_t size() const { return size_; }
+    int32_t price() const { return price_; }
+    char action() const { return action_; }
+    bool side() const { return side_; }
+};
+
+// message plus the instrument it belongs to, for files carrying a whole product complex (see
+// BookManager in book_manager.h). instrument_id_ fits in message's padding so it's still 32 bytes
+struct InstrumentMessage {
+    uint64_t id_;
+    uint64_t time_;
+    uint32_t size_;
+    int32_t price_;
+    uint32_t instrument_id_;
+    char action_;
+    bool side_;
+
+    InstrumentMessage() = default;
+
+    InstrumentMessage(uint64_t id, uint64_t time, uint32_t size, int32_t price, char action, bool side,
+                      uint32_t instrument_id)
+            : id_(id), time_(time), size_(size), price_(price), instrument_id_(instrument_id), action_(action),
+              side_(side) {}
+
+    uint64_t id() const { return id_; }
+    uint64_t time() const { return time_; }
+    uint32_t size() const { return size_; }
+    int32_t price() const { return price_; }
+    char action() const { return action_; }
+    bool side() const { return side_; }
+    uint32_t instrument_id() const { return instrument_id_; }
+};
+
+// const view over a run of messages, what the replay loops take whether the messages came from the
+// parser's message_stream_ or straight out of a mapped file
+struct MessageSpan {
+    const message* data_ = nullptr;
+    size_t size_ = 0;
+
+    MessageSpan() = default;
+    MessageSpan(const message* data, size_t size) : data_(data), size_(size) {}
+    explicit MessageSpan(const std::vector<message>& messages) : data_(messages.data()), size_(messages.size()) {}
+
+    const message* begin() const { return data_; }
+    const message* end() const { return data_ + size_; }
+    size_t size() const { return size_; }
+    const message& operator[](size_t i) const { return data_[i]; }
 };
 
 #endif //DATABENTO_ORDERBOOK_MESSAGE_H
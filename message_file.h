@@ -0,0 +1,153 @@
+#ifndef VECTOR_OB_MESSAGE_FILE_H
+#define VECTOR_OB_MESSAGE_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "message.h"
+#include "parser.cpp"
+
+// binary replay file: a 64 byte header followed by record_count_ message structs exactly as they sit in
+// memory, so loading one is an mmap and the records are used in place. written and read on little
+// endian machines only, the header's record_size_ catches a message layout change and version_ anything else
+
+static constexpr char MESSAGE_FILE_MAGIC[8] = {'O', 'B', 'M', 'S', 'G', 'B', 'I', 'N'};
+static constexpr uint32_t MESSAGE_FILE_VERSION = 1;
+
+struct MessageFileHeader {
+    char magic_[8];
+    uint32_t version_;
+    uint32_t record_size_;
+    uint64_t record_count_;
+    char symbol_[32];
+    uint64_t reserved_;
+};
+static_assert(sizeof(MessageFileHeader) == 64, "records start on the 64 byte boundary after the header");
+
+// writes messages to path, padding bytes in each record are zeroed so the same input always gives the
+// same file
+inline void write_message_file(const std::string& path, MessageSpan messages, const std::string& symbol) {
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        throw ParserException("Failed to open for writing: " + path);
+    }
+
+    MessageFileHeader header{};
+    std::memcpy(header.magic_, MESSAGE_FILE_MAGIC, sizeof(header.magic_));
+    header.version_ = MESSAGE_FILE_VERSION;
+    header.record_size_ = sizeof(message);
+    header.record_count_ = messages.size();
+    std::strncpy(header.symbol_, symbol.c_str(), sizeof(header.symbol_) - 1);
+
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+
+    static constexpr size_t CHUNK = 4096;
+    std::vector<message> chunk(CHUNK);
+    for (size_t start = 0; ok && start < messages.size(); start += CHUNK) {
+        size_t count = std::min(CHUNK, messages.size() - start);
+        std::memset(static_cast<void*>(chunk.data()), 0, count * sizeof(message));
+        for (size_t i = 0; i < count; ++i) {
+            const message& msg = messages[start + i];
+            chunk[i].id_ = msg.id_;
+            chunk[i].time_ = msg.time_;
+            chunk[i].size_ = msg.size_;
+            chunk[i].price_ = msg.price_;
+            chunk[i].action_ = msg.action_;
+            chunk[i].side_ = msg.side_;
+        }
+        ok = std::fwrite(chunk.data(), sizeof(message), count, file) == count;
+    }
+
+    if (std::fclose(file) != 0 || !ok) {
+        throw ParserException("Failed to write: " + path);
+    }
+}
+
+// read only mapping of a file written by write_message_file, messages() points straight into the mapping
+class MessageFile {
+public:
+    explicit MessageFile(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd == -1) {
+            throw ParserException("Failed to open file: " + path);
+        }
+
+        struct stat sb;
+        if (fstat(fd, &sb) == -1) {
+            close(fd);
+            throw ParserException("Failed to get file stats");
+        }
+        file_size_ = sb.st_size;
+        if (file_size_ < sizeof(MessageFileHeader)) {
+            close(fd);
+            throw ParserException("Not a message file: " + path);
+        }
+
+        mapped_file_ = mmap(nullptr, file_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapped_file_ == MAP_FAILED) {
+            mapped_file_ = nullptr;
+            throw ParserException("Failed to memory map file");
+        }
+
+        const auto* header = static_cast<const MessageFileHeader*>(mapped_file_);
+        const char* error = nullptr;
+        if (std::memcmp(header->magic_, MESSAGE_FILE_MAGIC, sizeof(header->magic_)) != 0) {
+            error = "Not a message file: ";
+        } else if (header->version_ != MESSAGE_FILE_VERSION) {
+            error = "Unsupported message file version: ";
+        } else if (header->record_size_ != sizeof(message)) {
+            error = "Message file record size doesn't match this build: ";
+        } else if (header->record_count_ > (file_size_ - sizeof(MessageFileHeader)) / sizeof(message)) {
+            error = "Truncated message file: ";
+        }
+        if (error) {
+            munmap(mapped_file_, file_size_);
+            mapped_file_ = nullptr;
+            throw ParserException(error + path);
+        }
+
+        madvise(mapped_file_, file_size_, MADV_SEQUENTIAL);
+    }
+
+    ~MessageFile() {
+        if (mapped_file_) munmap(mapped_file_, file_size_);
+    }
+
+    MessageFile(const MessageFile&) = delete;
+    MessageFile& operator=(const MessageFile&) = delete;
+
+    // true if path starts with the message file magic, how main tells a binary file from a csv
+    static bool is_message_file(const std::string& path) {
+        char magic[sizeof(MESSAGE_FILE_MAGIC)] = {};
+        FILE* file = std::fopen(path.c_str(), "rb");
+        if (!file) return false;
+        size_t read = std::fread(magic, 1, sizeof(magic), file);
+        std::fclose(file);
+        return read == sizeof(magic) && std::memcmp(magic, MESSAGE_FILE_MAGIC, sizeof(magic)) == 0;
+    }
+
+    const MessageFileHeader& header() const { return *static_cast<const MessageFileHeader*>(mapped_file_); }
+
+    MessageSpan messages() const {
+        const auto* records = reinterpret_cast<const message*>(static_cast<const char*>(mapped_file_)
+                                                               + sizeof(MessageFileHeader));
+        return MessageSpan(records, header().record_count_);
+    }
+
+    std::string symbol() const { return std::string(header().symbol_, strnlen(header().symbol_, sizeof(header().symbol_))); }
+    size_t get_file_size() const { return file_size_; }
+
+private:
+    void* mapped_file_ = nullptr;
+    size_t file_size_ = 0;
+};
+
+#endif //VECTOR_OB_MESSAGE_FILE_H
@@ -0,0 +1,123 @@
+#ifndef VECTOR_OB_PACKED_MESSAGE_H
+#define VECTOR_OB_PACKED_MESSAGE_H
+
+#include <cstdint>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+#include "message.h"
+
+static constexpr uint32_t NO_ORDER_HANDLE = UINT32_MAX;
+
+// 24 byte replay record vs message's 32 (6 of which are padding). the timestamp is stored as the
+// nanoseconds since the previous record in 24 bits, with action and side packed into the top byte of the
+// same word (action is ascii so it fits in 7 bits, side takes the 8th). handle_ is an optional dense 32 bit
+// id for the order, NO_ORDER_HANDLE unless the stream was encoded with handles
+struct PackedMessage {
+    uint64_t id_;
+    int32_t price_;
+    uint32_t size_;
+    uint32_t handle_;
+    uint32_t delta_action_;
+
+    static constexpr uint32_t DELTA_BITS = 24;
+    static constexpr uint32_t DELTA_MASK = (1u << DELTA_BITS) - 1;
+    // delta didn't fit (gap over ~16.7ms or time went backwards), the time is the next escaped_times_ entry
+    static constexpr uint32_t DELTA_ESCAPE = DELTA_MASK;
+
+    uint32_t delta() const { return delta_action_ & DELTA_MASK; }
+    char action() const { return static_cast<char>((delta_action_ >> DELTA_BITS) & 0x7F); }
+    bool side() const { return (delta_action_ >> 31) != 0; }
+};
+static_assert(sizeof(PackedMessage) == 24, "packed record should stay 24 bytes");
+
+// what the books see when replaying a PackedMessageStream, the record plus its decoded timestamp, with
+// the same accessors as message
+class PackedMessageView {
+public:
+    PackedMessageView(const PackedMessage& record, uint64_t time) : record_(record), time_(time) {}
+
+    uint64_t id() const { return record_.id_; }
+    uint64_t time() const { return time_; }
+    uint32_t size() const { return record_.size_; }
+    int32_t price() const { return record_.price_; }
+    char action() const { return record_.action(); }
+    bool side() const { return record_.side(); }
+    uint32_t handle() const { return record_.handle_; }
+
+private:
+    const PackedMessage& record_;
+    uint64_t time_;
+};
+
+// a message stream in PackedMessage form. timestamps only decode in order, so replay goes through
+// for_each rather than indexing
+class PackedMessageStream {
+private:
+    std::vector<PackedMessage> records_;
+    std::vector<uint64_t> escaped_times_;
+    uint64_t base_time_ = 0;
+
+public:
+    // assign_handles gives every distinct order id a dense handle, in order of first appearance
+    static PackedMessageStream encode(MessageSpan messages, bool assign_handles = false) {
+        PackedMessageStream stream;
+        stream.records_.reserve(messages.size());
+        stream.base_time_ = messages.size() ? messages[0].time_ : 0;
+
+        std::unordered_map<uint64_t, uint32_t> handles;
+        uint64_t prev_time = stream.base_time_;
+        for (const auto& msg : messages) {
+            if (static_cast<unsigned char>(msg.action_) > 0x7F) {
+                throw std::invalid_argument("action doesn't fit in 7 bits");
+            }
+
+            uint32_t delta;
+            if (msg.time_ >= prev_time && msg.time_ - prev_time < PackedMessage::DELTA_ESCAPE) {
+                delta = static_cast<uint32_t>(msg.time_ - prev_time);
+            } else {
+                delta = PackedMessage::DELTA_ESCAPE;
+                stream.escaped_times_.push_back(msg.time_);
+            }
+            prev_time = msg.time_;
+
+            uint32_t handle = NO_ORDER_HANDLE;
+            if (assign_handles) {
+                auto it = handles.try_emplace(msg.id_, static_cast<uint32_t>(handles.size())).first;
+                handle = it->second;
+            }
+
+            PackedMessage record{};
+            record.id_ = msg.id_;
+            record.price_ = msg.price_;
+            record.size_ = msg.size_;
+            record.handle_ = handle;
+            record.delta_action_ = delta
+                                   | static_cast<uint32_t>(msg.action_) << PackedMessage::DELTA_BITS
+                                   | static_cast<uint32_t>(msg.side_) << 31;
+            stream.records_.push_back(record);
+        }
+        return stream;
+    }
+
+    template<typename Fn>
+    __attribute__((always_inline))
+    void for_each(Fn&& fn) const {
+        uint64_t time = base_time_;
+        const uint64_t* escaped = escaped_times_.data();
+        for (const auto& record : records_) {
+            const uint32_t delta = record.delta();
+            time = __builtin_expect(delta == PackedMessage::DELTA_ESCAPE, 0) ? *escaped++ : time + delta;
+            fn(PackedMessageView(record, time));
+        }
+    }
+
+    size_t size() const { return records_.size(); }
+    size_t escaped() const { return escaped_times_.size(); }
+
+    size_t bytes() const {
+        return records_.size() * sizeof(PackedMessage) + escaped_times_.size() * sizeof(uint64_t);
+    }
+};
+
+#endif //VECTOR_OB_PACKED_MESSAGE_H
@@ -2,6 +2,9 @@
 
 #include <string>
 #include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
 #include <vector>
 #include <memory>
 #include <iostream>
@@ -11,13 +14,20 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <stdexcept>
+#include <thread>
+#include <exception>
 #include "message.h"
+#include "platform.h"
 
 class ParserException : public std::runtime_error {
 public:
     explicit ParserException(const std::string& msg) : std::runtime_error(msg) {}
 };
 
+// simd is the vectorized tokenizer + swar integer decode, scalar is the original strchr/strtoull line
+// parser, kept as the reference the simd path has to match
+enum class ParseMode { simd, scalar };
+
 class Parser {
 public:
     explicit Parser(const std::string& file_path)
@@ -25,7 +35,6 @@ public:
         if (!std::filesystem::exists(file_path)) {
             throw ParserException("File does not exist: " + file_path);
         }
-        message_stream_.reserve(9000000);
     }
 
     ~Parser() {
@@ -57,8 +66,112 @@ public:
         return *this;
     }
 
-    void parse() {
+    // threads > 1 splits the file at line boundaries and parses the chunks in parallel, the message
+    // stream comes out in file order either way
+    void parse(ParseMode mode = ParseMode::simd, size_t threads = 1) {
+        mode_ = mode;
         std::cout << "parsing messages" << std::endl;
+        map_file();
+        message_stream_.reserve(file_size_ / APPROX_LINE_BYTES);
+
+        try {
+            parse_mapped_data(threads);
+        } catch (const std::exception& e) {
+            cleanup();
+            throw;
+        }
+        std::cout << "finished parsing" << std::endl;
+    }
+
+    // replays the file through handler(const message&) without building message_stream_, the file is
+    // parsed STREAM_WINDOW bytes at a time into a small batch that's handed over before the next window
+    // is parsed, and the pages behind the window are dropped from the mapping. memory stays flat however
+    // big the file is. returns the number of messages
+    template<typename Handler>
+    size_t stream(Handler&& handler, ParseMode mode = ParseMode::simd) {
+        mode_ = mode;
+        map_file();
+        madvise(mapped_file_, file_size_, MADV_SEQUENTIAL);
+
+        std::vector<message> batch;
+        batch.reserve(STREAM_WINDOW / APPROX_LINE_BYTES);
+        const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        const char* end = mapped_file_ + file_size_;
+        char* released = mapped_file_;
+        size_t count = 0;
+
+        try {
+            const char* current = skip_header();
+            while (current < end) {
+                const char* window_end = next_line_start(current + std::min<size_t>(STREAM_WINDOW, end - current), end);
+                parse_range(current, window_end, batch);
+                for (const auto& msg : batch) {
+                    handler(msg);
+                }
+                count += batch.size();
+                batch.clear();
+                current = window_end;
+
+                char* done = mapped_file_ + ((current - mapped_file_) & ~(page_size - 1));
+                if (done > released) {
+                    madvise(released, done - released, MADV_DONTNEED);
+                    released = done;
+                }
+            }
+        } catch (const std::exception& e) {
+            cleanup();
+            throw;
+        }
+        cleanup();
+        return count;
+    }
+
+    // single threaded parse straight into out instead of message_stream_, how MessageColumns gets filled
+    // without going through the row layout first
+    template<typename Out>
+    void parse_into(Out& out, ParseMode mode = ParseMode::simd) {
+        mode_ = mode;
+        map_file();
+        try {
+            parse_range(skip_header(), mapped_file_ + file_size_, out);
+        } catch (const std::exception& e) {
+            cleanup();
+            throw;
+        }
+        cleanup();
+    }
+
+    // parse_into for files with a 7th instrument_id column (ts_event,action,side,price,size,order_id,instrument_id),
+    // Out takes emplace_back(id, time, size, price, action, side, instrument_id), eg a vector<InstrumentMessage>
+    template<typename Out>
+    void parse_instruments_into(Out& out, ParseMode mode = ParseMode::simd) {
+        mode_ = mode;
+        map_file();
+        out.reserve(out.size() + file_size_ / APPROX_LINE_BYTES);
+        try {
+            parse_range<INSTRUMENT_FIELD_COUNT>(skip_header(), mapped_file_ + file_size_, out);
+        } catch (const std::exception& e) {
+            cleanup();
+            throw;
+        }
+        cleanup();
+    }
+
+    const std::string& get_file_path() const { return file_path_; }
+    size_t get_message_count() const { return message_stream_.size(); }
+    size_t get_file_size() const { return file_size_; }
+    std::vector<message> message_stream_;
+
+private:
+    std::string file_path_;
+    char* mapped_file_;
+    size_t file_size_;
+    ParseMode mode_ = ParseMode::simd;
+
+    // bytes parsed per stream() batch
+    static constexpr size_t STREAM_WINDOW = 256 * 1024;
+
+    void map_file() {
         int fd = open(file_path_.c_str(), O_RDONLY);
         if (fd == -1) {
             throw ParserException("Failed to open file: " + file_path_);
@@ -79,24 +192,27 @@ public:
             mapped_file_ = nullptr;
             throw ParserException("Failed to memory map file");
         }
+    }
 
-        try {
-            parse_mapped_data();
-        } catch (const std::exception& e) {
-            cleanup();
-            throw;
+    // first byte after the two header lines
+    const char* skip_header() const {
+        const char* current = mapped_file_;
+        const char* end = mapped_file_ + file_size_;
+
+        for (int i = 0; i < 2 && current < end; ++i) {
+            current = static_cast<const char*>(memchr(current, '\n', end - current));
+            if (current) ++current;
+            else throw ParserException("Invalid file format: missing header");
         }
-        std::cout << "finished parsing" << std::endl;
+        return current;
     }
 
-    const std::string& get_file_path() const { return file_path_; }
-    size_t get_message_count() const { return message_stream_.size(); }
-    std::vector<message> message_stream_;
-
-private:
-    std::string file_path_;
-    char* mapped_file_;
-    size_t file_size_;
+    // first byte of the line after the one pos is in
+    static const char* next_line_start(const char* pos, const char* end) {
+        if (pos >= end) return end;
+        const char* newline = static_cast<const char*>(memchr(pos, '\n', end - pos));
+        return newline ? newline + 1 : end;
+    }
 
     void cleanup() {
         if (mapped_file_) {
@@ -105,25 +221,280 @@ private:
         }
     }
 
-    void parse_mapped_data() {
-        char* current = mapped_file_;
-        char* end = mapped_file_ + file_size_;
+    void parse_mapped_data(size_t threads) {
+        const char* current = skip_header();
+        const char* end = mapped_file_ + file_size_;
 
-        for (int i = 0; i < 2 && current < end; ++i) {
-            current = static_cast<char*>(memchr(current, '\n', end - current));
-            if (current) ++current;
-            else throw ParserException("Invalid file format: missing header");
+        if (threads <= 1) {
+            parse_range(current, end, message_stream_);
+            return;
         }
 
+        // chunk boundaries are pushed forward to just past the next newline, so no line is split
+        std::vector<const char*> bounds{current};
+        const size_t chunk_size = (end - current) / threads;
+        for (size_t i = 1; i < threads; ++i) {
+            bounds.push_back(next_line_start(std::max(bounds.back(), current + i * chunk_size), end));
+        }
+        bounds.push_back(end);
+
+        std::vector<std::vector<message>> segments(threads);
+        std::vector<std::exception_ptr> errors(threads);
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < threads; ++i) {
+            workers.emplace_back([this, i, &bounds, &segments, &errors] {
+                try {
+                    segments[i].reserve((bounds[i + 1] - bounds[i]) / APPROX_LINE_BYTES);
+                    parse_range(bounds[i], bounds[i + 1], segments[i]);
+                } catch (...) {
+                    errors[i] = std::current_exception();
+                }
+            });
+        }
+        for (auto& worker : workers) worker.join();
+        for (auto& error : errors) {
+            if (error) std::rethrow_exception(error);
+        }
+
+        // stitch the segments back together in file order, each thread copies its own segment into place
+        std::vector<size_t> offsets{message_stream_.size()};
+        for (const auto& segment : segments) offsets.push_back(offsets.back() + segment.size());
+        message_stream_.resize(offsets.back());
+        workers.clear();
+        for (size_t i = 0; i < threads; ++i) {
+            workers.emplace_back([this, i, &offsets, &segments] {
+                std::copy(segments[i].begin(), segments[i].end(), message_stream_.begin() + offsets[i]);
+                std::vector<message>().swap(segments[i]);
+            });
+        }
+        for (auto& worker : workers) worker.join();
+    }
+
+    // rough bytes per csv line, only used to size the per thread buffers
+    static constexpr size_t APPROX_LINE_BYTES = 32;
+
+    // ts_event,action,side,price,size,order_id
+    static constexpr size_t FIELD_COUNT = 6;
+    // ts_event,action,side,price,size,order_id,instrument_id
+    static constexpr size_t INSTRUMENT_FIELD_COUNT = 7;
+
+    // Out is anything with message's emplace_back(id, time, size, price, action, side), a message vector
+    // or MessageColumns. with Fields = INSTRUMENT_FIELD_COUNT it gets the instrument_id as a 7th argument
+    template<size_t Fields = FIELD_COUNT, typename Out>
+    void parse_range(const char* current, const char* end, Out& out) {
+        if (mode_ == ParseMode::scalar) {
+            while (current < end) {
+                const char* line_end = static_cast<const char*>(memchr(current, '\n', end - current));
+                if (!line_end) line_end = end;
+                parse_line<Fields>(current, line_end, out);
+                current = line_end + 1;
+            }
+            return;
+        }
+
+        SeparatorScanner scanner(current, end);
+        const char* fields[Fields + 1];
         while (current < end) {
-            char* line_end = static_cast<char*>(memchr(current, '\n', end - current));
-            if (!line_end) line_end = end;
-            parse_line(current, line_end);
-            current = line_end + 1;
+            // fields[i] is the first byte of field i, fields[Fields] is one past the line's newline
+            fields[0] = current;
+            bool well_formed = true;
+            for (size_t i = 1; i <= Fields; ++i) {
+                const char* sep = scanner.next();
+                const bool last = i == Fields;
+                if (sep == end ? !last : (*sep == '\n') != last) {
+                    well_formed = false;
+                    break;
+                }
+                fields[i] = sep + 1;
+            }
+
+            if (__builtin_expect(!well_formed, 0)) {
+                // blank, short or long line, hand it to the strchr path so it comes out the same as it always has
+                const char* line_end = static_cast<const char*>(memchr(current, '\n', end - current));
+                if (!line_end) line_end = end;
+                parse_line<Fields>(current, line_end, out);
+                current = line_end + 1;
+                scanner.seek(current);
+                continue;
+            }
+
+            parse_fields<Fields>(fields, out);
+            current = fields[Fields];
         }
     }
 
-    void parse_line(const char* start, const char* end) {
+    // walks the ',' and '\n' positions of the mapped file in order, 64 bytes of the file are compared at a
+    // time into a bitmask and next() pops the lowest set bit. the last partial block is copied into a
+    // padded buffer so the vector loads never read past the mapping
+    class SeparatorScanner {
+    public:
+        SeparatorScanner(const char* start, const char* end) : end_(end) { seek(start); }
+
+        __attribute__((always_inline))
+        const char* next() {
+            while (mask_ == 0) {
+                block_ += BLOCK;
+                if (block_ >= end_) return end_;
+                load();
+            }
+            const char* sep = block_ + __builtin_ctzll(mask_);
+            mask_ &= mask_ - 1;
+            return sep;
+        }
+
+        void seek(const char* pos) {
+            block_ = pos;
+            if (block_ < end_) load();
+            else mask_ = 0;
+        }
+
+    private:
+        static constexpr size_t BLOCK = 64;
+        const char* block_;
+        const char* end_;
+        uint64_t mask_;
+
+        __attribute__((always_inline))
+        void load() {
+            if (__builtin_expect(end_ - block_ >= static_cast<ptrdiff_t>(BLOCK), 1)) {
+                mask_ = platform::match_mask64(block_, ',', '\n');
+            } else {
+                char tail[BLOCK] = {};
+                std::memcpy(tail, block_, end_ - block_);
+                mask_ = platform::match_mask64(tail, ',', '\n');
+            }
+        }
+    };
+
+    // 8 ascii digits, most significant first in memory, to their value (ie the bytes of "12345678" in a
+    // little endian word). pairs, then quads, then the two halves are combined with multiplies
+    __attribute__((always_inline))
+    static uint64_t swar_eight_digits(uint64_t digits) {
+        digits = digits * 10 + (digits >> 8);
+        digits = ((digits & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))
+                  + ((digits >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32))) >> 32;
+        return digits;
+    }
+
+    // true if every byte of a digit-subtracted word is 0..9
+    __attribute__((always_inline))
+    static bool swar_all_digits(uint64_t digits) {
+        return ((digits + 0x7676767676767676ULL) | digits) & 0x8080808080808080ULL ? false : true;
+    }
+
+    __attribute__((always_inline))
+    static uint64_t load_word(const char* p) {
+        uint64_t word;
+        std::memcpy(&word, p, sizeof(word));
+        return word;
+    }
+
+    // decodes the len <= 8 digits at p, reading 8 bytes from p. the bytes past the field are shifted out
+    // after subtracting '0', so their borrows can't reach the digits
+    __attribute__((always_inline))
+    static bool decode_short(const char* p, size_t len, uint64_t& value) {
+        uint64_t digits = (load_word(p) - 0x3030303030303030ULL) << ((8 - len) * 8);
+        if (!swar_all_digits(digits)) return false;
+        value = swar_eight_digits(digits);
+        return true;
+    }
+
+    // decodes exactly 8 digits at p
+    __attribute__((always_inline))
+    static bool decode_eight(const char* p, uint64_t& value) {
+        uint64_t digits = load_word(p) - 0x3030303030303030ULL;
+        if (!swar_all_digits(digits)) return false;
+        value = swar_eight_digits(digits);
+        return true;
+    }
+
+    // plain unsigned decimal field [p, p + len) of up to max_len digits. false for anything else (signs,
+    // spaces, longer values that could overflow, a field too close to the end of the file for the 8 byte
+    // loads), the callers hand those to strtoull/strtol on a terminated copy so the result matches the old parser
+    __attribute__((always_inline))
+    static bool try_decode_digits(const char* p, size_t len, size_t max_len, const char* end, uint64_t& value) {
+        if (len == 0) {
+            value = 0;
+            return true;
+        }
+        if (len > max_len || end - p < 8) return false;
+
+        uint64_t high, mid, low;
+        if (len <= 8) {
+            return decode_short(p, len, value);
+        }
+        if (len <= 16) {
+            if (!decode_short(p, len - 8, high) || !decode_eight(p + len - 8, low)) return false;
+            value = high * 100000000ULL + low;
+            return true;
+        }
+        if (!decode_short(p, len - 16, high) || !decode_eight(p + len - 16, mid) || !decode_eight(p + len - 8, low)) {
+            return false;
+        }
+        value = high * 10000000000000000ULL + mid * 100000000ULL + low;
+        return true;
+    }
+
+    // copies a field into a terminated buffer for the libc fallbacks, the mapping isn't terminated
+    static void terminate_field(const char* p, size_t len, char (&buf)[64]) {
+        len = std::min(len, sizeof(buf) - 1);
+        std::memcpy(buf, p, len);
+        buf[len] = '\0';
+    }
+
+    __attribute__((always_inline))
+    static uint64_t decode_unsigned(const char* p, size_t len, const char* end) {
+        uint64_t value;
+        if (__builtin_expect(try_decode_digits(p, len, 19, end, value), 1)) return value;
+        char buf[64];
+        terminate_field(p, len, buf);
+        return strtoull(buf, nullptr, 10);
+    }
+
+    // 18 digits always fit in an int64 either side of zero
+    __attribute__((always_inline))
+    static int64_t decode_signed(const char* p, size_t len, const char* end) {
+        const bool negative = len > 0 && *p == '-';
+        uint64_t value;
+        if (__builtin_expect(try_decode_digits(p + negative, len - negative, 18, end, value)
+                             && (!negative || len > 1), 1)) {
+            return negative ? -static_cast<int64_t>(value) : static_cast<int64_t>(value);
+        }
+        char buf[64];
+        terminate_field(p, len, buf);
+        return strtol(buf, nullptr, 10);
+    }
+
+    template<size_t Fields, typename Out>
+    __attribute__((always_inline))
+    void parse_fields(const char* const* fields, Out& out) {
+        const char* end = mapped_file_ + file_size_;
+        // a field's length excludes its separator, the last one also drops a trailing '\r'
+        auto field_len = [fields](size_t i) {
+            size_t len = static_cast<size_t>(fields[i + 1] - fields[i] - 1);
+            if (i == Fields - 1 && len && fields[i][len - 1] == '\r') --len;
+            return len;
+        };
+        size_t id_len = field_len(5);
+
+        uint64_t ts_event = decode_unsigned(fields[0], field_len(0), end);
+        char action = *fields[1];
+        char side = *fields[2];
+        int32_t price = static_cast<int32_t>(decode_signed(fields[3], field_len(3), end));
+        uint32_t size = static_cast<uint32_t>(decode_unsigned(fields[4], field_len(4), end));
+        uint64_t order_id = decode_unsigned(fields[5], id_len, end);
+
+        bool bid_or_ask = (side == 'B');
+        if constexpr (Fields == INSTRUMENT_FIELD_COUNT) {
+            uint32_t instrument_id = static_cast<uint32_t>(decode_unsigned(fields[6], field_len(6), end));
+            out.emplace_back(order_id, ts_event, size, price, action, bid_or_ask, instrument_id);
+        } else {
+            out.emplace_back(order_id, ts_event, size, price, action, bid_or_ask);
+        }
+    }
+
+    template<size_t Fields, typename Out>
+    void parse_line(const char* start, const char* end, Out& out) {
         uint64_t ts_event, order_id;
         int32_t price;
         uint32_t size;
@@ -153,6 +524,12 @@ private:
         order_id = strtoull(token_start, nullptr, 10);
 
         bool bid_or_ask = (side == 'B');
-        message_stream_.emplace_back(order_id, ts_event, size, price, action, bid_or_ask);
+        if constexpr (Fields == INSTRUMENT_FIELD_COUNT) {
+            token_end = static_cast<const char*>(memchr(token_start, ',', end - token_start));
+            uint32_t instrument_id = token_end ? strtoul(token_end + 1, nullptr, 10) : 0;
+            out.emplace_back(order_id, ts_event, size, price, action, bid_or_ask, instrument_id);
+        } else {
+            out.emplace_back(order_id, ts_event, size, price, action, bid_or_ask);
+        }
     }
 };
\ No newline at end of file
@@ -0,0 +1,137 @@
+#ifndef VECTOR_OB_PIPELINE_H
+#define VECTOR_OB_PIPELINE_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <thread>
+#include "parser.cpp"
+#include "platform.h"
+#include "spsc_ring.h"
+
+// two thread replay: a parser thread streams the file into an SpscRing<message> and a book thread
+// drains the ring in batches into process_msg, so parsing and book updates overlap instead of taking
+// turns on one core
+
+struct PipelineOptions {
+    int parser_cpu = -1;
+    int book_cpu = -1;
+    size_t ring_capacity = 1 << 16;
+    size_t batch_size = 256;
+};
+
+struct PipelineStats {
+    static constexpr size_t OCCUPANCY_BUCKETS = 16;
+
+    size_t messages_ = 0;
+    uint64_t elapsed_ns_ = 0;
+    // times the parser found the ring full / the book found it empty. a full ring means the book is the
+    // bottleneck, an empty one means the parser is
+    uint64_t parser_stalls_ = 0;
+    uint64_t book_idle_ = 0;
+    bool parser_pinned_ = true;
+    bool book_pinned_ = true;
+    // ring occupancy seen by the book before each batch it drains, bucket i is i/16ths of capacity
+    std::array<uint64_t, OCCUPANCY_BUCKETS + 1> occupancy_{};
+    uint64_t occupancy_sum_ = 0;
+    size_t capacity_ = 0;
+
+    void sample(size_t queued) {
+        ++occupancy_[queued * OCCUPANCY_BUCKETS / capacity_];
+        occupancy_sum_ += queued;
+    }
+
+    uint64_t samples() const {
+        uint64_t n = 0;
+        for (uint64_t count : occupancy_) n += count;
+        return n;
+    }
+
+    double mean_occupancy() const {
+        uint64_t n = samples();
+        return n ? static_cast<double>(occupancy_sum_) / n / capacity_ : 0.0;
+    }
+
+    // upper bound of the bucket the p-th sample falls in, as a fraction of capacity
+    double occupancy_percentile(double p) const {
+        uint64_t n = samples();
+        uint64_t seen = 0;
+        for (size_t i = 0; i <= OCCUPANCY_BUCKETS; ++i) {
+            seen += occupancy_[i];
+            if (static_cast<double>(seen) >= p * n) {
+                return std::min(1.0, static_cast<double>(i + 1) / OCCUPANCY_BUCKETS);
+            }
+        }
+        return 1.0;
+    }
+};
+
+// spin with pause, but give the core up now and then in case both threads ended up sharing one
+__attribute__((always_inline))
+inline void backoff(uint64_t spins) {
+    if (spins % 1024 == 0) std::this_thread::yield();
+    else platform::cpu_relax();
+}
+
+template<typename Book>
+PipelineStats run_pipeline(Parser& parser, Book& book, const PipelineOptions& options = {}) {
+    SpscRing<message> ring(options.ring_capacity);
+    std::atomic<bool> parser_done{false};
+    std::exception_ptr parser_error;
+
+    PipelineStats stats;
+    stats.capacity_ = ring.capacity();
+    platform::Stopwatch timer;
+
+    // the parser counts into locals and the book into its own PipelineStats, merged once both are done,
+    // so the two threads never write the same cache line while running
+    std::thread parser_thread([&] {
+        bool pinned = platform::pin_thread(options.parser_cpu);
+        uint64_t stalls = 0;
+        try {
+            parser.stream([&](const message& msg) {
+                while (__builtin_expect(!ring.try_push(msg), 0)) {
+                    backoff(++stalls);
+                }
+            });
+        } catch (...) {
+            parser_error = std::current_exception();
+        }
+        stats.parser_pinned_ = pinned;
+        stats.parser_stalls_ = stalls;
+        parser_done.store(true, std::memory_order_release);
+    });
+
+    PipelineStats book_stats;
+    book_stats.capacity_ = ring.capacity();
+    std::thread book_thread([&] {
+        book_stats.book_pinned_ = platform::pin_thread(options.book_cpu);
+        auto process = [&book](const message& msg) { book.process_msg(msg); };
+        while (true) {
+            size_t queued = ring.readable();
+            if (queued == 0) {
+                // everything pushed before done was set is visible once we've seen done
+                if (parser_done.load(std::memory_order_acquire) && ring.readable() == 0) break;
+                backoff(++book_stats.book_idle_);
+                continue;
+            }
+            book_stats.sample(queued);
+            book_stats.messages_ += ring.consume(process, options.batch_size);
+        }
+    });
+
+    parser_thread.join();
+    book_thread.join();
+    stats.elapsed_ns_ = timer.elapsed_ns();
+    stats.messages_ = book_stats.messages_;
+    stats.book_idle_ = book_stats.book_idle_;
+    stats.book_pinned_ = book_stats.book_pinned_;
+    stats.occupancy_ = book_stats.occupancy_;
+    stats.occupancy_sum_ = book_stats.occupancy_sum_;
+
+    if (parser_error) std::rethrow_exception(parser_error);
+    return stats;
+}
+
+#endif //VECTOR_OB_PIPELINE_H
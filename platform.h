@@ -0,0 +1,151 @@
+#ifndef VECTOR_OB_PLATFORM_H
+#define VECTOR_OB_PLATFORM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// the bits that differ between the m1 we started on and the linux x86 boxes we run on: a cheap timer and
+// the handful of simd helpers the books and the parser use. everything is picked at compile time, build with
+// -march=native (the default in CMakeLists.txt) to get avx2 where the cpu has it
+namespace platform {
+
+// monotonic wall clock in nanoseconds, clock_gettime on linux and macos
+__attribute__((always_inline))
+inline uint64_t now_ns() {
+    timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+// raw cycle counter for timing short sections, rdtsc on x86, the virtual counter on arm64,
+// falls back to now_ns() anywhere else. the units differ per platform, use cycles_per_ns() to convert
+__attribute__((always_inline))
+inline uint64_t cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t value;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(value));
+    return value;
+#else
+    return now_ns();
+#endif
+}
+
+// counter ticks per nanosecond, measured once against now_ns() over ~10ms
+inline double cycles_per_ns() {
+    static const double ratio = [] {
+        uint64_t ns_start = now_ns();
+        uint64_t cycles_start = cycles();
+        while (now_ns() - ns_start < 10000000ULL) {}
+        uint64_t ns_end = now_ns();
+        uint64_t cycles_end = cycles();
+        return static_cast<double>(cycles_end - cycles_start) / static_cast<double>(ns_end - ns_start);
+    }();
+    return ratio;
+}
+
+// spin loop hint, lets the sibling hyperthread run while we wait on another core
+__attribute__((always_inline))
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// pins the calling thread to one cpu, false if that failed or the platform can't (macos has no hard
+// affinity). a negative cpu leaves the thread where the scheduler put it
+inline bool pin_thread(int cpu) {
+    if (cpu < 0) return true;
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+class Stopwatch {
+public:
+    Stopwatch() : start_(now_ns()) {}
+
+    void reset() { start_ = now_ns(); }
+    uint64_t elapsed_ns() const { return now_ns() - start_; }
+    uint64_t elapsed_ms() const { return elapsed_ns() / 1000000ULL; }
+
+private:
+    uint64_t start_;
+};
+
+// bit i set if p[i] is a or b, for the 64 bytes at p (all 64 must be readable). avx2 does it in two
+// compares per char, sse2 and neon in four, neon has no movemask so the lanes are weighted and folded
+__attribute__((always_inline))
+inline uint64_t match_mask64(const char* p, char a, char b) {
+#if defined(__AVX2__)
+    const __m256i va = _mm256_set1_epi8(a);
+    const __m256i vb = _mm256_set1_epi8(b);
+    __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+    uint32_t lo_mask = static_cast<uint32_t>(_mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_cmpeq_epi8(lo, va), _mm256_cmpeq_epi8(lo, vb))));
+    uint32_t hi_mask = static_cast<uint32_t>(_mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_cmpeq_epi8(hi, va), _mm256_cmpeq_epi8(hi, vb))));
+    return static_cast<uint64_t>(hi_mask) << 32 | lo_mask;
+#elif defined(__SSE2__)
+    const __m128i va = _mm_set1_epi8(a);
+    const __m128i vb = _mm_set1_epi8(b);
+    uint64_t mask = 0;
+    for (int i = 0; i < 4; ++i) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i * 16));
+        uint64_t bits = static_cast<uint32_t>(_mm_movemask_epi8(
+                _mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb))));
+        mask |= bits << (i * 16);
+    }
+    return mask;
+#elif defined(__ARM_NEON)
+    const uint8x16_t va = vdupq_n_u8(static_cast<uint8_t>(a));
+    const uint8x16_t vb = vdupq_n_u8(static_cast<uint8_t>(b));
+    static const uint8_t weights[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    const uint8x16_t w = vld1q_u8(weights);
+    uint8x16_t m[4];
+    for (int i = 0; i < 4; ++i) {
+        uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(p + i * 16));
+        m[i] = vandq_u8(vorrq_u8(vceqq_u8(v, va), vceqq_u8(v, vb)), w);
+    }
+    uint8x16_t sum = vpaddq_u8(vpaddq_u8(m[0], m[1]), vpaddq_u8(m[2], m[3]));
+    sum = vpaddq_u8(sum, sum);
+    return vgetq_lane_u64(vreinterpretq_u64_u8(sum), 0);
+#else
+    uint64_t mask = 0;
+    for (int i = 0; i < 64; ++i) {
+        mask |= static_cast<uint64_t>(p[i] == a || p[i] == b) << i;
+    }
+    return mask;
+#endif
+}
+
+} // namespace platform
+
+#endif //VECTOR_OB_PLATFORM_H
@@ -0,0 +1,143 @@
+#ifndef VECTOR_OB_SHARDED_REPLAY_H
+#define VECTOR_OB_SHARDED_REPLAY_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "book_manager.h"
+#include "message.h"
+#include "pipeline.h"
+#include "platform.h"
+#include "spsc_ring.h"
+
+// multi core replay of a multi instrument stream. instruments are independent, so they're split into
+// shards, each owned by one worker thread with its own SpscRing. a dispatcher thread walks the parsed
+// stream and pushes each message onto its instrument's shard ring, the workers drain their rings into
+// the manager's books. a book is only ever touched by the worker that owns it, so there are no locks,
+// and messages for one instrument stay in file order because they all go through the same ring
+
+struct ShardedOptions {
+    size_t shards = 1;
+    // dispatcher on first_cpu, worker i on first_cpu + 1 + i, -1 leaves the threads unpinned
+    int first_cpu = -1;
+    size_t ring_capacity = 1 << 14;
+    size_t batch_size = 256;
+};
+
+struct ShardStats {
+    size_t instruments_ = 0;
+    size_t messages_ = 0;
+    // times the worker found its ring empty
+    uint64_t idle_ = 0;
+    bool pinned_ = true;
+};
+
+struct ShardedStats {
+    size_t messages_ = 0;
+    uint64_t elapsed_ns_ = 0;
+    // times the dispatcher found a shard's ring full
+    uint64_t dispatcher_stalls_ = 0;
+    bool dispatcher_pinned_ = true;
+    std::vector<ShardStats> shards_;
+
+    // busiest shard's messages over the mean, 1.0 is a perfect split
+    double imbalance() const {
+        if (shards_.empty() || messages_ == 0) return 1.0;
+        size_t busiest = 0;
+        for (const auto& shard : shards_) busiest = std::max(busiest, shard.messages_);
+        return static_cast<double>(busiest) * shards_.size() / messages_;
+    }
+};
+
+// shard for each local instrument id. instruments are placed busiest first, each onto the shard with the
+// fewest messages so far, which keeps the split even when a few instruments carry most of the flow
+inline std::vector<uint32_t> assign_shards(const std::vector<InstrumentMessage>& messages, size_t instruments,
+                                           size_t shards) {
+    std::vector<size_t> counts(instruments, 0);
+    for (const auto& msg : messages) ++counts[msg.instrument_id_];
+
+    std::vector<uint32_t> order(instruments);
+    for (uint32_t i = 0; i < instruments; ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), [&counts](uint32_t a, uint32_t b) { return counts[a] > counts[b]; });
+
+    std::vector<uint32_t> shard_of(instruments, 0);
+    std::vector<size_t> load(shards, 0);
+    for (uint32_t instrument : order) {
+        size_t lightest = std::min_element(load.begin(), load.end()) - load.begin();
+        shard_of[instrument] = static_cast<uint32_t>(lightest);
+        load[lightest] += counts[instrument];
+    }
+    return shard_of;
+}
+
+// messages have to be localize()d by manager first, and the manager can't add instruments while this runs
+template<typename Book>
+ShardedStats run_sharded(const std::vector<InstrumentMessage>& messages, BookManager<Book>& manager,
+                         const ShardedOptions& options = {}) {
+    const size_t shards = std::max<size_t>(1, options.shards);
+    const std::vector<uint32_t> shard_of = assign_shards(messages, manager.size(), shards);
+
+    std::vector<std::unique_ptr<SpscRing<InstrumentMessage>>> rings;
+    for (size_t i = 0; i < shards; ++i) {
+        rings.push_back(std::make_unique<SpscRing<InstrumentMessage>>(options.ring_capacity));
+    }
+    std::atomic<bool> dispatch_done{false};
+
+    ShardedStats stats;
+    stats.shards_.resize(shards);
+    for (uint32_t shard : shard_of) ++stats.shards_[shard].instruments_;
+    platform::Stopwatch timer;
+
+    std::thread dispatcher([&] {
+        stats.dispatcher_pinned_ = platform::pin_thread(options.first_cpu);
+        uint64_t stalls = 0;
+        for (const auto& msg : messages) {
+            auto& ring = *rings[shard_of[msg.instrument_id_]];
+            while (__builtin_expect(!ring.try_push(msg), 0)) {
+                backoff(++stalls);
+            }
+        }
+        stats.dispatcher_stalls_ = stalls;
+        dispatch_done.store(true, std::memory_order_release);
+    });
+
+    // each worker counts into its own ShardStats, copied out after the join so they don't share a line
+    std::vector<std::thread> workers;
+    std::vector<ShardStats> worker_stats(shards);
+    for (size_t i = 0; i < shards; ++i) {
+        workers.emplace_back([&, i] {
+            ShardStats local;
+            local.pinned_ = platform::pin_thread(options.first_cpu < 0 ? -1 : options.first_cpu + 1 + static_cast<int>(i));
+            auto& ring = *rings[i];
+            auto process = [&manager](const InstrumentMessage& msg) { manager.process_msg(msg); };
+            while (true) {
+                size_t consumed = ring.consume(process, options.batch_size);
+                if (consumed == 0) {
+                    // everything pushed before done was set is visible once we've seen done
+                    if (dispatch_done.load(std::memory_order_acquire) && ring.readable() == 0) break;
+                    backoff(++local.idle_);
+                    continue;
+                }
+                local.messages_ += consumed;
+            }
+            worker_stats[i] = local;
+        });
+    }
+
+    dispatcher.join();
+    for (auto& worker : workers) worker.join();
+    stats.elapsed_ns_ = timer.elapsed_ns();
+
+    for (size_t i = 0; i < shards; ++i) {
+        stats.shards_[i].messages_ = worker_stats[i].messages_;
+        stats.shards_[i].idle_ = worker_stats[i].idle_;
+        stats.shards_[i].pinned_ = worker_stats[i].pinned_;
+        stats.messages_ += worker_stats[i].messages_;
+    }
+    return stats;
+}
+
+#endif //VECTOR_OB_SHARDED_REPLAY_H
@@ -0,0 +1,367 @@
+#ifndef VECTOR_OB_SHM_FEED_H
+#define VECTOR_OB_SHM_FEED_H
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "book_level.h"
+#include "platform.h"
+
+// book updates for other processes on the same box. the publisher creates a POSIX shared memory segment
+// (shm_open + mmap) holding a header and a power of two ring of fixed size slots, consumers map the same
+// segment read only and copy updates straight out of it. there's one writer and any number of readers, and
+// the writer never waits for them: every slot carries its own sequence, bumped to odd before the write and
+// to even after like the Seqlock in top_of_book.h, so a reader that falls a whole ring behind sees the
+// sequence has moved past the one it wanted and skips ahead to the live end instead of holding the book up
+
+static constexpr uint64_t FEED_MAGIC = 0x3144464d4853424fULL;  // "OBSHMFD1" little endian
+static constexpr uint32_t FEED_VERSION = 1;
+// levels a side the level deltas can cover
+static constexpr uint32_t MAX_FEED_DEPTH = 64;
+
+enum class FeedKind : uint32_t {
+    // best bid and ask changed, both are in the update
+    top = 1,
+    // one aggregated level inside the published depth changed, volume 0 means it left the window
+    level = 2,
+    // the publisher is done, nothing follows
+    end = 3,
+};
+
+// one record in the ring. a top update has both sides' best level (volume 0 for an empty side), a level
+// update only fills the side it's for
+struct FeedUpdate {
+    // platform::now_ns() when it was published. CLOCK_MONOTONIC is the same clock in every process on the
+    // box, so now_ns() - publish_ns_ in the reader is the publish to read latency
+    uint64_t publish_ns_;
+    // exchange time of the message that caused it
+    uint64_t time_;
+    FeedKind kind_;
+    // level updates, true for bid
+    uint32_t is_bid_;
+    BookLevel bid_;
+    BookLevel ask_;
+
+    const BookLevel& level() const { return is_bid_ ? bid_ : ask_; }
+};
+
+static_assert(std::is_trivially_copyable<FeedUpdate>::value, "feed updates are copied word by word");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "the ring's atomics have to work across processes");
+
+struct FeedSlot {
+    // 2n + 1 while record n is being written into it, 2n + 2 once it's there
+    std::atomic<uint64_t> sequence_;
+    std::atomic<uint64_t> words_[sizeof(FeedUpdate) / sizeof(uint64_t)];
+};
+
+static_assert(sizeof(FeedUpdate) % sizeof(uint64_t) == 0);
+static_assert(sizeof(FeedSlot) == 64, "one slot per cache line");
+
+struct FeedHeader {
+    // stored last, with release, so a reader that maps the segment mid setup sees 0 and tries again
+    std::atomic<uint64_t> magic_;
+    uint32_t version_;
+    // levels a side the publisher sends level updates for, 0 for top of book only
+    uint32_t depth_;
+    uint64_t capacity_;
+    // records published so far, readers start from here to join at the live end
+    alignas(64) std::atomic<uint64_t> head_;
+};
+
+inline size_t feed_segment_size(uint64_t capacity) {
+    return sizeof(FeedHeader) + capacity * sizeof(FeedSlot);
+}
+
+inline std::runtime_error feed_error(const std::string& what, const std::string& name) {
+    return std::runtime_error(what + " " + name + ": " + std::strerror(errno));
+}
+
+// the writing end. name is a shm name like "/vector_ob", a stale segment with the same name is replaced.
+// the segment is unlinked when the publisher goes away, readers that already have it mapped keep reading
+class FeedPublisher {
+public:
+    FeedPublisher(const std::string& name, size_t capacity = 1 << 16, uint32_t depth = 0) : name_(name) {
+        capacity_ = 1;
+        while (capacity_ < capacity) capacity_ <<= 1;
+        mask_ = capacity_ - 1;
+        size_ = feed_segment_size(capacity_);
+
+        shm_unlink(name_.c_str());
+        int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+        if (fd == -1) throw feed_error("Failed to create shared memory", name_);
+        if (ftruncate(fd, static_cast<off_t>(size_)) == -1) {
+            close(fd);
+            shm_unlink(name_.c_str());
+            throw feed_error("Failed to size shared memory", name_);
+        }
+        void* mapped = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mapped == MAP_FAILED) {
+            shm_unlink(name_.c_str());
+            throw feed_error("Failed to map shared memory", name_);
+        }
+
+        // a fresh segment is zero filled, which is already every slot's initial sequence
+        header_ = new (mapped) FeedHeader();
+        slots_ = reinterpret_cast<FeedSlot*>(static_cast<char*>(mapped) + sizeof(FeedHeader));
+        header_->version_ = FEED_VERSION;
+        header_->depth_ = std::min(depth, MAX_FEED_DEPTH);
+        header_->capacity_ = capacity_;
+        header_->head_.store(0, std::memory_order_relaxed);
+        header_->magic_.store(FEED_MAGIC, std::memory_order_release);
+    }
+
+    FeedPublisher(const FeedPublisher&) = delete;
+    FeedPublisher& operator=(const FeedPublisher&) = delete;
+
+    ~FeedPublisher() {
+        finish();
+        munmap(header_, size_);
+        shm_unlink(name_.c_str());
+    }
+
+    // stamps publish_ns_ and writes the update into the next slot
+    __attribute__((always_inline))
+    void publish(FeedUpdate& update) {
+        update.publish_ns_ = platform::now_ns();
+        uint64_t words[sizeof(FeedUpdate) / sizeof(uint64_t)];
+        std::memcpy(words, &update, sizeof(FeedUpdate));
+
+        FeedSlot& slot = slots_[head_ & mask_];
+        slot.sequence_.store(2 * head_ + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < std::size(words); ++i) {
+            slot.words_[i].store(words[i], std::memory_order_relaxed);
+        }
+        slot.sequence_.store(2 * head_ + 2, std::memory_order_release);
+        header_->head_.store(++head_, std::memory_order_release);
+    }
+
+    // tells readers nothing else is coming, the destructor does it if nobody did
+    void finish() {
+        if (finished_) return;
+        finished_ = true;
+        FeedUpdate end{};
+        end.kind_ = FeedKind::end;
+        publish(end);
+    }
+
+    uint32_t depth() const { return header_->depth_; }
+    uint64_t published() const { return head_; }
+    const std::string& name() const { return name_; }
+
+private:
+    std::string name_;
+    FeedHeader* header_ = nullptr;
+    FeedSlot* slots_ = nullptr;
+    size_t size_ = 0;
+    uint64_t capacity_ = 0;
+    uint64_t mask_ = 0;
+    uint64_t head_ = 0;
+    bool finished_ = false;
+};
+
+// the reading end, maps an existing segment read only and starts at its live end
+class FeedReader {
+public:
+    enum class Result { ok, empty, overrun };
+
+    // throws if there's no segment called name, or it isn't set up yet, exists() is for polling
+    explicit FeedReader(const std::string& name) {
+        if (!try_open(name)) throw feed_error("No feed at", name);
+    }
+
+    FeedReader(const FeedReader&) = delete;
+    FeedReader& operator=(const FeedReader&) = delete;
+
+    ~FeedReader() {
+        if (header_) munmap(const_cast<FeedHeader*>(header_), size_);
+    }
+
+    // next update into out. empty if the publisher hasn't written it yet, overrun if the publisher lapped
+    // this reader, in which case the missed records are added to lost() and the reader moves to the live end
+    __attribute__((always_inline))
+    Result try_read(FeedUpdate& out) {
+        const FeedSlot& slot = slots_[next_ & mask_];
+        const uint64_t wanted = 2 * next_ + 2;
+        const uint64_t before = slot.sequence_.load(std::memory_order_acquire);
+        if (before < wanted) return Result::empty;
+
+        uint64_t words[sizeof(FeedUpdate) / sizeof(uint64_t)];
+        if (before == wanted) {
+            for (size_t i = 0; i < std::size(words); ++i) {
+                words[i] = slot.words_[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence_.load(std::memory_order_relaxed) == wanted) {
+                std::memcpy(&out, words, sizeof(FeedUpdate));
+                ++next_;
+                return Result::ok;
+            }
+        }
+
+        const uint64_t head = header_->head_.load(std::memory_order_acquire);
+        lost_ += head - next_;
+        next_ = head;
+        return Result::overrun;
+    }
+
+    uint32_t depth() const { return header_->depth_; }
+    uint64_t capacity() const { return header_->capacity_; }
+    uint64_t position() const { return next_; }
+    uint64_t lost() const { return lost_; }
+
+    // for waiting on a publisher that hasn't started yet, false until the segment exists and is set up
+    static bool exists(const std::string& name) {
+        FeedReader reader;
+        return reader.try_open(name);
+    }
+
+private:
+    const FeedHeader* header_ = nullptr;
+    const FeedSlot* slots_ = nullptr;
+    size_t size_ = 0;
+    uint64_t mask_ = 0;
+    uint64_t next_ = 0;
+    uint64_t lost_ = 0;
+
+    FeedReader() = default;
+
+    bool try_open(const std::string& name) {
+        int fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd == -1) return false;
+
+        struct stat sb{};
+        if (fstat(fd, &sb) == -1 || static_cast<size_t>(sb.st_size) < sizeof(FeedHeader)) {
+            close(fd);
+            return false;
+        }
+        void* mapped = mmap(nullptr, static_cast<size_t>(sb.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mapped == MAP_FAILED) return false;
+
+        const auto* header = static_cast<const FeedHeader*>(mapped);
+        if (header->magic_.load(std::memory_order_acquire) != FEED_MAGIC || header->version_ != FEED_VERSION
+            || feed_segment_size(header->capacity_) > static_cast<size_t>(sb.st_size)) {
+            munmap(mapped, static_cast<size_t>(sb.st_size));
+            return false;
+        }
+
+        header_ = header;
+        slots_ = reinterpret_cast<const FeedSlot*>(static_cast<const char*>(mapped) + sizeof(FeedHeader));
+        size_ = static_cast<size_t>(sb.st_size);
+        mask_ = header->capacity_ - 1;
+        next_ = header->head_.load(std::memory_order_acquire);
+        return true;
+    }
+};
+
+// wraps a book for replay like PublishedBook does and feeds its changes into a FeedPublisher: a top update
+// whenever the best bid or ask level changes, and with depth > 0 a level update for every level in the
+// best depth a side that appeared, changed or dropped out since the previous message, so a reader can keep
+// those levels without rebuilding the book. Book is any book with get_top_levels<Side>(out, n)
+template<typename Book>
+class FeedBook {
+public:
+    FeedBook(Book& book, FeedPublisher& feed) : book_(book), feed_(feed), depth_(std::max<uint32_t>(1, feed.depth())) {}
+
+    template<typename Msg>
+    __attribute__((always_inline))
+    void process_msg(const Msg& msg) {
+        book_.process_msg(msg);
+        publish(msg.time());
+    }
+
+    Book& book() { return book_; }
+
+private:
+    Book& book_;
+    FeedPublisher& feed_;
+    const uint32_t depth_;
+    BookLevel last_bids_[MAX_FEED_DEPTH] = {};
+    BookLevel last_asks_[MAX_FEED_DEPTH] = {};
+    size_t last_bid_levels_ = 0;
+    size_t last_ask_levels_ = 0;
+
+    __attribute__((always_inline))
+    void publish(uint64_t time) {
+        BookLevel bids[MAX_FEED_DEPTH];
+        BookLevel asks[MAX_FEED_DEPTH];
+        const size_t bid_levels = book_.template get_top_levels<true>(bids, depth_);
+        const size_t ask_levels = book_.template get_top_levels<false>(asks, depth_);
+
+        const bool top_changed = top(bids, bid_levels) != top(last_bids_, last_bid_levels_)
+                                 || top(asks, ask_levels) != top(last_asks_, last_ask_levels_);
+        if (feed_.depth()) {
+            publish_levels<true>(bids, bid_levels, time);
+            publish_levels<false>(asks, ask_levels, time);
+        }
+        if (top_changed) {
+            FeedUpdate update{};
+            update.time_ = time;
+            update.kind_ = FeedKind::top;
+            update.bid_ = top(bids, bid_levels);
+            update.ask_ = top(asks, ask_levels);
+            feed_.publish(update);
+        }
+
+        std::copy(bids, bids + bid_levels, last_bids_);
+        std::copy(asks, asks + ask_levels, last_asks_);
+        last_bid_levels_ = bid_levels;
+        last_ask_levels_ = ask_levels;
+    }
+
+    static BookLevel top(const BookLevel* levels, size_t count) {
+        return count ? levels[0] : BookLevel{};
+    }
+
+    // both lists are best first, so one merge pass finds what was added, changed or removed
+    template<bool Side>
+    __attribute__((always_inline))
+    void publish_levels(const BookLevel* now, size_t now_count, uint64_t time) {
+        const BookLevel* before = Side ? last_bids_ : last_asks_;
+        const size_t before_count = Side ? last_bid_levels_ : last_ask_levels_;
+        auto better = [](int32_t a, int32_t b) { return Side ? a > b : a < b; };
+
+        size_t i = 0;
+        size_t j = 0;
+        while (i < now_count || j < before_count) {
+            if (j == before_count || (i < now_count && better(now[i].price_, before[j].price_))) {
+                publish_level<Side>(now[i++], time);
+            }
+            else if (i == now_count || better(before[j].price_, now[i].price_)) {
+                publish_level<Side>({before[j++].price_, 0, 0}, time);
+            }
+            else {
+                if (now[i] != before[j]) publish_level<Side>(now[i], time);
+                ++i;
+                ++j;
+            }
+        }
+    }
+
+    template<bool Side>
+    __attribute__((always_inline))
+    void publish_level(const BookLevel& level, uint64_t time) {
+        FeedUpdate update{};
+        update.time_ = time;
+        update.kind_ = FeedKind::level;
+        update.is_bid_ = Side;
+        (Side ? update.bid_ : update.ask_) = level;
+        feed_.publish(update);
+    }
+};
+
+#endif //VECTOR_OB_SHM_FEED_H
@@ -0,0 +1,141 @@
+#ifndef VECTOR_OB_SLAB_POOL_H
+#define VECTOR_OB_SLAB_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <vector>
+#include <sys/mman.h>
+
+// fixed size object pool carved out of large contiguous chunks. a chunk is a single mmap, so building a
+// pool of a million orders is one syscall instead of a million mallocs, and pages only get touched
+// as objects are handed out. new objects come off a bump pointer so orders added back to back sit next to
+// each other, returned objects go on an intrusive LIFO free list threaded through their own storage so
+// the next allocation reuses the slot that was freed most recently and is still in cache
+template<typename T>
+class SlabPool {
+private:
+    static_assert(std::is_trivially_destructible<T>::value, "SlabPool never runs destructors");
+
+    union Slot {
+        Slot* next_;
+        alignas(T) unsigned char storage_[sizeof(T)];
+    };
+
+    struct Chunk {
+        void* mapping_;
+        size_t mapping_bytes_;
+        Slot* slots_;
+    };
+
+    static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+    std::vector<Chunk> chunks_;
+    size_t chunk_objects_;
+    bool huge_pages_;
+
+    size_t current_chunk_;
+    Slot* bump_;
+    Slot* bump_end_;
+    Slot* free_list_;
+
+    size_t live_;
+
+    void map_chunk() {
+        size_t bytes = chunk_objects_ * sizeof(Slot);
+        size_t mapping_bytes = bytes;
+        if (huge_pages_) {
+            // over-map by one huge page so we can hand the kernel a 2mb aligned range
+            bytes = (bytes + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+            mapping_bytes = bytes + HUGE_PAGE_SIZE;
+        }
+
+        void* mapping = mmap(nullptr, mapping_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mapping == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+
+        auto* base = static_cast<unsigned char*>(mapping);
+        if (huge_pages_) {
+            auto addr = reinterpret_cast<uintptr_t>(mapping);
+            base += ((addr + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1)) - addr;
+#ifdef MADV_HUGEPAGE
+            madvise(base, bytes, MADV_HUGEPAGE);
+#endif
+        }
+
+        chunks_.push_back({mapping, mapping_bytes, reinterpret_cast<Slot*>(base)});
+    }
+
+    void start_chunk(size_t idx) {
+        if (idx == chunks_.size()) {
+            map_chunk();
+        }
+        current_chunk_ = idx;
+        bump_ = chunks_[idx].slots_;
+        bump_end_ = bump_ + chunk_objects_;
+    }
+
+public:
+    // huge pages are skipped for chunks smaller than one, a pool per instrument would otherwise pin a
+    // 2mb page per book for a few hundred orders
+    explicit SlabPool(size_t chunk_objects, bool huge_pages = true)
+            : chunk_objects_(chunk_objects ? chunk_objects : 1)
+            , huge_pages_(huge_pages && chunk_objects_ * sizeof(Slot) >= HUGE_PAGE_SIZE)
+            , current_chunk_(0)
+            , bump_(nullptr)
+            , bump_end_(nullptr)
+            , free_list_(nullptr)
+            , live_(0) {
+        chunks_.reserve(16);
+        start_chunk(0);
+    }
+
+    ~SlabPool() {
+        for (auto& chunk : chunks_) {
+            munmap(chunk.mapping_, chunk.mapping_bytes_);
+        }
+    }
+
+    SlabPool(const SlabPool&) = delete;
+    SlabPool& operator=(const SlabPool&) = delete;
+
+    __attribute__((always_inline))
+    T* allocate() {
+        Slot* slot;
+        if (free_list_) {
+            slot = free_list_;
+            free_list_ = slot->next_;
+        } else {
+            if (__builtin_expect(bump_ == bump_end_, 0)) {
+                start_chunk(current_chunk_ + 1);
+            }
+            slot = bump_++;
+        }
+        ++live_;
+        return new (slot->storage_) T();
+    }
+
+    __attribute__((always_inline))
+    void deallocate(T* object) {
+        Slot* slot = reinterpret_cast<Slot*>(object);
+        slot->next_ = free_list_;
+        free_list_ = slot;
+        --live_;
+    }
+
+    // hands every object back at once, anything still pointing into the pool is invalid afterwards.
+    // chunks stay mapped so a refill after a reset doesn't go back to the kernel
+    void reset() {
+        free_list_ = nullptr;
+        live_ = 0;
+        start_chunk(0);
+    }
+
+    size_t live() const { return live_; }
+    size_t capacity() const { return chunks_.size() * chunk_objects_; }
+    size_t chunk_count() const { return chunks_.size(); }
+};
+
+#endif //VECTOR_OB_SLAB_POOL_H
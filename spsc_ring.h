@@ -0,0 +1,88 @@
+#ifndef VECTOR_OB_SPSC_RING_H
+#define VECTOR_OB_SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// bounded lock free ring for exactly one producer thread and one consumer thread. head_ is only written
+// by the consumer and tail_ only by the producer, each on its own cache line, and each side keeps a cached
+// copy of the other side's index so it only touches the shared line when its cached view says the ring
+// is full (producer) or empty (consumer)
+template<typename T>
+class SpscRing {
+private:
+    static constexpr size_t CACHE_LINE = 64;
+
+    std::vector<T> slots_;
+    const size_t mask_;
+
+    alignas(CACHE_LINE) std::atomic<uint64_t> head_{0};
+    alignas(CACHE_LINE) uint64_t cached_tail_ = 0;
+
+    alignas(CACHE_LINE) std::atomic<uint64_t> tail_{0};
+    alignas(CACHE_LINE) uint64_t cached_head_ = 0;
+
+    static size_t round_up_pow2(size_t n) {
+        size_t capacity = 1;
+        while (capacity < n) capacity <<= 1;
+        return capacity;
+    }
+
+public:
+    explicit SpscRing(size_t capacity)
+            : slots_(round_up_pow2(capacity))
+            , mask_(slots_.size() - 1) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // producer side, false if the ring is full
+    __attribute__((always_inline))
+    bool try_push(const T& value) {
+        const uint64_t tail = tail_.load(std::memory_order_relaxed);
+        if (__builtin_expect(tail - cached_head_ == slots_.size(), 0)) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (tail - cached_head_ == slots_.size()) return false;
+        }
+        slots_[tail & mask_] = value;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer side, calls fn on up to max_items queued items in order and then frees their slots in one
+    // store. returns how many it consumed, 0 if the ring was empty
+    template<typename Fn>
+    __attribute__((always_inline))
+    size_t consume(Fn&& fn, size_t max_items) {
+        const uint64_t head = head_.load(std::memory_order_relaxed);
+        if (cached_tail_ == head) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (cached_tail_ == head) return 0;
+        }
+        const size_t available = static_cast<size_t>(cached_tail_ - head);
+        const size_t count = available < max_items ? available : max_items;
+        for (size_t i = 0; i < count; ++i) {
+            fn(slots_[(head + i) & mask_]);
+        }
+        head_.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+    // consumer side, refreshes the consumer's view of the producer and returns how many items are queued
+    __attribute__((always_inline))
+    size_t readable() {
+        cached_tail_ = tail_.load(std::memory_order_acquire);
+        return static_cast<size_t>(cached_tail_ - head_.load(std::memory_order_relaxed));
+    }
+
+    // approximate from either side, exact when both are quiet
+    size_t size() const {
+        return static_cast<size_t>(tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire));
+    }
+
+    size_t capacity() const { return slots_.size(); }
+};
+
+#endif //VECTOR_OB_SPSC_RING_H
@@ -0,0 +1,325 @@
+#ifndef VECTOR_OB_SWISS_TABLE_H
+#define VECTOR_OB_SWISS_TABLE_H
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "hash_policies.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// swiss table style alternative to OpenAddressTable, same insert/erase/find api. slots are split into
+// groups of 16, each slot has a control byte holding either EMPTY, DELETED or the low 7 bits of the hash,
+// and a lookup compares all 16 control bytes of a group against the fingerprint in one simd compare.
+// the control bytes live in their own array, so a hit is usually one load of the control group plus one
+// load of the matching entry, and a miss usually never touches the entries at all
+namespace swiss {
+
+static constexpr int8_t EMPTY = -128;
+static constexpr int8_t DELETED = -2;
+static constexpr size_t GROUP_WIDTH = 16;
+
+// set of matching slots in a group, iterated lowest slot first
+class BitMask {
+public:
+#if defined(__SSE2__) || !defined(__ARM_NEON)
+    static constexpr int SHIFT = 0;
+#else
+    // neon narrows each byte compare to a nibble, we keep only the top bit of each nibble
+    static constexpr int SHIFT = 2;
+#endif
+
+    explicit BitMask(uint64_t mask) : mask_(mask) {}
+
+    __attribute__((always_inline))
+    explicit operator bool() const { return mask_ != 0; }
+
+    __attribute__((always_inline))
+    size_t lowest() const { return static_cast<size_t>(__builtin_ctzll(mask_)) >> SHIFT; }
+
+    __attribute__((always_inline))
+    void clear_lowest() { mask_ &= mask_ - 1; }
+
+private:
+    uint64_t mask_;
+};
+
+class Group {
+public:
+    __attribute__((always_inline))
+    explicit Group(const int8_t* ctrl) {
+#if defined(__SSE2__)
+        ctrl_ = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+#elif defined(__ARM_NEON)
+        ctrl_ = vld1q_s8(ctrl);
+#else
+        std::memcpy(ctrl_, ctrl, GROUP_WIDTH);
+#endif
+    }
+
+    __attribute__((always_inline))
+    BitMask match(int8_t h2) const {
+#if defined(__SSE2__)
+        return BitMask(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl_, _mm_set1_epi8(h2)))));
+#elif defined(__ARM_NEON)
+        return neon_mask(vceqq_s8(ctrl_, vdupq_n_s8(h2)));
+#else
+        uint64_t mask = 0;
+        for (size_t i = 0; i < GROUP_WIDTH; ++i) {
+            mask |= static_cast<uint64_t>(ctrl_[i] == h2) << i;
+        }
+        return BitMask(mask);
+#endif
+    }
+
+    __attribute__((always_inline))
+    BitMask match_empty() const { return match(EMPTY); }
+
+    // EMPTY and DELETED are the only control bytes with the sign bit set
+    __attribute__((always_inline))
+    BitMask match_empty_or_deleted() const {
+#if defined(__SSE2__)
+        return BitMask(static_cast<uint32_t>(_mm_movemask_epi8(ctrl_)));
+#elif defined(__ARM_NEON)
+        return neon_mask(vcltq_s8(ctrl_, vdupq_n_s8(0)));
+#else
+        uint64_t mask = 0;
+        for (size_t i = 0; i < GROUP_WIDTH; ++i) {
+            mask |= static_cast<uint64_t>(ctrl_[i] < 0) << i;
+        }
+        return BitMask(mask);
+#endif
+    }
+
+private:
+#if defined(__SSE2__)
+    __m128i ctrl_;
+#elif defined(__ARM_NEON)
+    int8x16_t ctrl_;
+
+    __attribute__((always_inline))
+    static BitMask neon_mask(uint8x16_t cmp) {
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(cmp), 4)), 0);
+        return BitMask(mask & 0x8888888888888888ULL);
+    }
+#else
+    int8_t ctrl_[GROUP_WIDTH];
+#endif
+};
+
+} // namespace swiss
+
+// Hash is one of the policies in hash_policies.h
+template<typename OrderType, typename Hash>
+class BasicSwissTable {
+private:
+    struct Entry {
+        uint64_t key_;
+        OrderType* val_;
+    };
+
+    std::vector<int8_t> ctrl_;
+    std::vector<Entry> entries_;
+    size_t size_;
+    size_t tombstones_;
+    size_t group_mask_;
+
+    static constexpr size_t MIN_CAPACITY = 64;
+
+    __attribute__((always_inline))
+    static int8_t h2(size_t hash) { return static_cast<int8_t>(hash & 0x7F); }
+
+    __attribute__((always_inline))
+    size_t first_group(size_t hash) const { return (hash >> 7) & group_mask_; }
+
+    // triangular probing over groups, visits every group once when the group count is a power of 2
+    __attribute__((always_inline))
+    size_t next_group(size_t group, size_t probe) const { return (group + probe) & group_mask_; }
+
+    __attribute__((always_inline))
+    size_t find_index(uint64_t key) const {
+        const size_t hash = hash_key(key);
+        const int8_t fingerprint = h2(hash);
+        size_t group = first_group(hash);
+
+        for (size_t probe = 1; ; ++probe) {
+            const size_t base = group * swiss::GROUP_WIDTH;
+            swiss::Group g(&ctrl_[base]);
+
+            for (auto match = g.match(fingerprint); match; match.clear_lowest()) {
+                size_t idx = base + match.lowest();
+                if (__builtin_expect(entries_[idx].key_ == key, 1)) {
+                    return idx;
+                }
+            }
+            if (g.match_empty()) {
+                return NOT_FOUND;
+            }
+            group = next_group(group, probe);
+        }
+    }
+
+    // first EMPTY or DELETED slot on the key's probe sequence, the table always has one
+    __attribute__((always_inline))
+    size_t find_insert_slot(size_t hash) const {
+        size_t group = first_group(hash);
+        for (size_t probe = 1; ; ++probe) {
+            const size_t base = group * swiss::GROUP_WIDTH;
+            auto free_slots = swiss::Group(&ctrl_[base]).match_empty_or_deleted();
+            if (free_slots) {
+                return base + free_slots.lowest();
+            }
+            group = next_group(group, probe);
+        }
+    }
+
+    void allocate(size_t capacity) {
+        ctrl_.assign(capacity, swiss::EMPTY);
+        entries_.assign(capacity, Entry{0, nullptr});
+        group_mask_ = capacity / swiss::GROUP_WIDTH - 1;
+        size_ = 0;
+        tombstones_ = 0;
+    }
+
+    void rehash(size_t new_capacity) {
+        std::vector<int8_t> old_ctrl = std::move(ctrl_);
+        std::vector<Entry> old_entries = std::move(entries_);
+        allocate(new_capacity);
+
+        for (size_t i = 0; i < old_ctrl.size(); ++i) {
+            if (old_ctrl[i] >= 0) {
+                const size_t hash = hash_key(old_entries[i].key_);
+                size_t idx = find_insert_slot(hash);
+                ctrl_[idx] = h2(hash);
+                entries_[idx] = old_entries[i];
+                ++size_;
+            }
+        }
+    }
+
+    static size_t capacity_for(size_t n) {
+        // keep the table at most 7/8 full
+        size_t target = MIN_CAPACITY;
+        while (target * 7 / 8 < n) target *= 2;
+        return target;
+    }
+
+public:
+    static constexpr size_t NOT_FOUND = static_cast<size_t>(-1);
+
+    explicit BasicSwissTable(size_t initial_size = MIN_CAPACITY) {
+        allocate(capacity_for(initial_size));
+    }
+
+    __attribute__((always_inline))
+    static size_t hash_key(uint64_t key) {
+        return Hash::hash(key);
+    }
+
+    __attribute__((always_inline))
+    bool insert(uint64_t key, OrderType* val) {
+        size_t idx = find_index(key);
+        if (idx != NOT_FOUND) {
+            entries_[idx].val_ = val;
+            return true;
+        }
+
+        if (__builtin_expect((size_ + tombstones_ + 1) * 8 > ctrl_.size() * 7, 0)) {
+            // mostly tombstones means we can clean up in place instead of growing
+            rehash(size_ * 2 >= ctrl_.size() * 7 / 8 ? ctrl_.size() * 2 : ctrl_.size());
+        }
+
+        const size_t hash = hash_key(key);
+        idx = find_insert_slot(hash);
+        if (ctrl_[idx] == swiss::DELETED) --tombstones_;
+        ctrl_[idx] = h2(hash);
+        entries_[idx] = Entry{key, val};
+        ++size_;
+        return true;
+    }
+
+    __attribute__((always_inline))
+    bool erase(uint64_t key) {
+        size_t idx = find_index(key);
+        if (idx == NOT_FOUND) return false;
+
+        // if the group already has an empty slot no probe sequence ever walked past it, so the slot can
+        // go straight back to EMPTY, otherwise leave a tombstone so later groups stay reachable
+        const size_t base = idx & ~(swiss::GROUP_WIDTH - 1);
+        if (swiss::Group(&ctrl_[base]).match_empty()) {
+            ctrl_[idx] = swiss::EMPTY;
+        } else {
+            ctrl_[idx] = swiss::DELETED;
+            ++tombstones_;
+        }
+        entries_[idx].val_ = nullptr;
+        --size_;
+        return true;
+    }
+
+    __attribute__((always_inline))
+    const OrderType* const * find(uint64_t key) const {
+        size_t idx = find_index(key);
+        return idx == NOT_FOUND ? nullptr : &entries_[idx].val_;
+    }
+
+    __attribute__((always_inline))
+    OrderType** find(uint64_t key) {
+        return const_cast<OrderType**>(const_cast<const BasicSwissTable*>(this)->find(key));
+    }
+
+    __attribute__((always_inline))
+    size_t size() const { return size_; }
+
+    __attribute__((always_inline))
+    bool empty() const { return size_ == 0; }
+
+    __attribute__((always_inline))
+    size_t capacity() const { return ctrl_.size(); }
+
+    __attribute__((always_inline))
+    double load_factor() const {
+        return static_cast<double>(size_) / ctrl_.size();
+    }
+
+    void clear() {
+        if (size_ == 0 && tombstones_ == 0) return;
+        std::memset(ctrl_.data(), static_cast<uint8_t>(swiss::EMPTY), ctrl_.size());
+        size_ = 0;
+        tombstones_ = 0;
+    }
+
+    // number of entries by how many groups a lookup has to visit past the first one to find them
+    std::vector<size_t> probe_histogram() const {
+        std::vector<size_t> histogram;
+        for (size_t i = 0; i < ctrl_.size(); ++i) {
+            if (ctrl_[i] < 0) continue;
+            const size_t target = i / swiss::GROUP_WIDTH;
+            size_t group = first_group(hash_key(entries_[i].key_));
+            size_t probes = 0;
+            while (group != target) {
+                ++probes;
+                group = next_group(group, probes);
+            }
+            if (probes >= histogram.size()) histogram.resize(probes + 1, 0);
+            ++histogram[probes];
+        }
+        return histogram;
+    }
+
+    void reserve(size_t n) {
+        size_t target = capacity_for(n);
+        if (target > ctrl_.size()) {
+            rehash(target);
+        }
+    }
+};
+
+template<typename OrderType>
+using SwissTable = BasicSwissTable<OrderType, XXHash>;
+
+#endif //VECTOR_OB_SWISS_TABLE_H
@@ -0,0 +1,251 @@
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "../message.h"
+#include "../book_level.h"
+#include "../vector/orderbook.cpp"
+#include "../map/map_orderbook.cpp"
+#include "../ladder/ladder_orderbook.cpp"
+#include "../ladder/inline_ladder_orderbook.cpp"
+
+// replays a random stream through every book, the pointer books with each order table, and checks after
+// every message that they agree with the map book on OpenAddressTable on the resting order count and the
+// best CHECK_LEVELS levels a side. ids mostly climb by up to ID_STEP but now and then jump by up to
+// BIG_ID_STEP, so a run covers hundreds of DirectIndexTable windows and pages still holding orders get
+// retired into its fallback. the odd id comes from behind the window or far ahead of it. the stream is
+// the awkward kind real feeds send now and then: cancels and fills with the other side or a wrong price,
+// modifies that change side, cancels and fills for ids that were never added, the odd clear, and stray
+// prices the ladders can't fit in their array (2,000,000,000, further out than PriceLadder::MAX_LEVELS
+// ticks, off the tick grid). exits 1 at the first disagreement
+
+static constexpr size_t CHECK_LEVELS = 10;
+static constexpr int32_t MID = 100000;
+static constexpr uint64_t FIRST_ID = 1 << 24;
+static constexpr uint64_t ID_STEP = 16;
+static constexpr uint64_t BIG_ID_STEP = 1 << 18;
+// more than DirectIndexTable's window plus its longest slide ahead, the climbing ids catch up with it
+static constexpr uint64_t NEAR_AHEAD = 5 << 19;
+// never caught up with
+static constexpr uint64_t FAR_AHEAD = 1ULL << 40;
+
+struct Resting {
+    uint64_t id_;
+    int32_t price_;
+    uint32_t size_;
+    bool side_;
+};
+
+class StreamGenerator {
+public:
+    StreamGenerator(uint64_t seed, int32_t tick) : rng_(seed), tick_(tick) {}
+
+    message next() {
+        time_ += 1 + rng_() % 1000;
+        const uint32_t roll = rng_() % 1000;
+        if (roll == 0) {
+            live_.clear();
+            return message(0, time_, 0, 0, 'R', false);
+        }
+        if (live_.empty() || roll < 450) return add();
+        if (roll < 700) return cancel();
+        if (roll < 850) return modify();
+        if (roll < 960) return fill();
+        return message(0, time_, 1 + rng_() % 50, near_touch(rng_() % 2), 'T', rng_() % 2);
+    }
+
+private:
+    std::mt19937_64 rng_;
+    int32_t tick_;
+    std::vector<Resting> live_;
+    uint64_t next_id_ = FIRST_ID;
+    // ids below FIRST_ID, behind any window the direct table has
+    uint64_t old_id_ = 1;
+    uint64_t time_ = 0;
+
+    bool one_in(uint32_t n) { return rng_() % n == 0; }
+
+    int32_t near_touch(bool side) {
+        if (one_in(200)) return stray();
+        const int32_t offset = static_cast<int32_t>(rng_() % 40) * tick_;
+        return side ? MID - offset : MID + offset;
+    }
+
+    int32_t stray() {
+        switch (rng_() % 4) {
+            case 0: return 2000000000;
+            case 1: return -2000000000;
+            case 2: return MID + static_cast<int32_t>(PriceLadder<true>::MAX_LEVELS + rng_() % 1000) * tick_;
+            default: return MID + 1 + static_cast<int32_t>(rng_() % 40) * tick_;
+        }
+    }
+
+    size_t pick() { return rng_() % live_.size(); }
+
+    // ids climbing from FIRST_ID are even, the ones far ahead of them odd so they never meet
+    uint64_t new_id() {
+        if (one_in(500)) return old_id_++;
+        next_id_ += 1 + (one_in(20) ? rng_() % BIG_ID_STEP : rng_() % ID_STEP);
+        if (one_in(1000)) return (next_id_ + (one_in(2) ? FAR_AHEAD : NEAR_AHEAD)) * 2 + 1;
+        return next_id_ * 2;
+    }
+
+    void forget(size_t i) {
+        live_[i] = live_.back();
+        live_.pop_back();
+    }
+
+    message add() {
+        const bool side = rng_() % 2;
+        Resting order{new_id(), near_touch(side), static_cast<uint32_t>(1 + rng_() % 100), side};
+        live_.push_back(order);
+        return message(order.id_, time_, order.size_, order.price_, 'A', order.side_);
+    }
+
+    message cancel() {
+        if (one_in(50)) return message(next_id_ + 1000000, time_, 10, MID, 'C', rng_() % 2);
+        const size_t i = pick();
+        Resting order = live_[i];
+        forget(i);
+        bool side = order.side_;
+        int32_t price = order.price_;
+        if (one_in(7)) side = !side;
+        if (one_in(7)) price = one_in(2) ? 0 : near_touch(rng_() % 2);
+        return message(order.id_, time_, order.size_, price, 'C', side);
+    }
+
+    message modify() {
+        const size_t i = pick();
+        Resting& order = live_[i];
+        if (one_in(20)) order.side_ = !order.side_;
+        const uint32_t roll = rng_() % 3;
+        if (roll == 0) order.price_ = near_touch(order.side_);
+        else if (roll == 1) order.size_ += 1 + rng_() % 20;
+        else order.size_ = 1 + rng_() % order.size_;
+        return message(order.id_, time_, order.size_, order.price_, 'M', order.side_);
+    }
+
+    message fill() {
+        if (one_in(50)) return message(next_id_ + 1000000, time_, 10, 0, 'F', rng_() % 2);
+        const size_t i = pick();
+        Resting& order = live_[i];
+        const uint32_t fill_size = 1 + rng_() % (order.size_ + 10);
+        const bool side = one_in(7) ? !order.side_ : order.side_;
+        const message msg(order.id_, time_, fill_size, 0, 'F', side);
+        if (fill_size >= order.size_) forget(i);
+        else order.size_ -= fill_size;
+        return msg;
+    }
+};
+
+struct BookView {
+    uint64_t count_ = 0;
+    size_t bid_levels_ = 0;
+    size_t ask_levels_ = 0;
+    BookLevel bids_[CHECK_LEVELS];
+    BookLevel asks_[CHECK_LEVELS];
+
+    bool operator==(const BookView& other) const {
+        return count_ == other.count_ && bid_levels_ == other.bid_levels_ && ask_levels_ == other.ask_levels_
+               && std::equal(bids_, bids_ + bid_levels_, other.bids_) && std::equal(asks_, asks_ + ask_levels_, other.asks_);
+    }
+};
+
+template<typename Book>
+static BookView view(const Book& book) {
+    BookView out;
+    out.count_ = book.get_count();
+    out.bid_levels_ = book.template get_top_levels<true>(out.bids_, CHECK_LEVELS);
+    out.ask_levels_ = book.template get_top_levels<false>(out.asks_, CHECK_LEVELS);
+    return out;
+}
+
+// one book under check, type erased so the list can hold every book/table combination
+class CheckedBook {
+public:
+    explicit CheckedBook(const char* name) : name_(name) {}
+    virtual ~CheckedBook() = default;
+    virtual void process_msg(const message& msg) = 0;
+    virtual BookView view() const = 0;
+    const char* name() const { return name_; }
+
+private:
+    const char* name_;
+};
+
+template<typename Book>
+class Checked : public CheckedBook {
+public:
+    template<typename... Args>
+    explicit Checked(const char* name, Args... args) : CheckedBook(name), book_(std::make_unique<Book>(args...)) {}
+    void process_msg(const message& msg) override { book_->process_msg(msg); }
+    BookView view() const override { return ::view(*book_); }
+
+private:
+    std::unique_ptr<Book> book_;
+};
+
+static void print_view(const char* name, const BookView& v) {
+    std::cerr << "  " << name << ": " << v.count_ << " orders, bids";
+    for (size_t i = 0; i < v.bid_levels_; ++i) std::cerr << " " << v.bids_[i].price_ << "x" << v.bids_[i].volume_;
+    std::cerr << ", asks";
+    for (size_t i = 0; i < v.ask_levels_; ++i) std::cerr << " " << v.asks_[i].price_ << "x" << v.asks_[i].volume_;
+    std::cerr << "\n";
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 4) {
+        std::cerr << "Usage: " << argv[0] << " [messages] [seed] [tick]\n";
+        return 1;
+    }
+
+    try {
+        const size_t steps = argc >= 2 ? std::stoul(argv[1]) : 300000;
+        const uint64_t seed = argc >= 3 ? std::stoull(argv[2]) : 1;
+        const int32_t tick = argc == 4 ? std::stoi(argv[3]) : 1;
+        if (tick <= 0) throw std::invalid_argument("tick must be positive");
+
+        // the reference book is first
+        std::vector<std::unique_ptr<CheckedBook>> books;
+        books.push_back(std::make_unique<Checked<Orderbook<OpenAddressTable>>>("map", 1 << 16));
+        books.push_back(std::make_unique<Checked<Vector_Orderbook<OpenAddressTable>>>("vector", 1 << 16));
+        books.push_back(std::make_unique<Checked<Ladder_Orderbook<OpenAddressTable>>>("ladder", tick, 1 << 16));
+        books.push_back(std::make_unique<Checked<InlineLadder_Orderbook>>("ladder_inline", tick, 1 << 16));
+        books.push_back(std::make_unique<Checked<Orderbook<DirectIndexTable>>>("map/direct", 1 << 16));
+        books.push_back(std::make_unique<Checked<Vector_Orderbook<DirectIndexTable>>>("vector/direct", 1 << 16));
+        books.push_back(std::make_unique<Checked<Ladder_Orderbook<DirectIndexTable>>>("ladder/direct", tick, 1 << 16));
+        // started small so the swiss tables grow, on top of the tombstones from erases and the clears
+        books.push_back(std::make_unique<Checked<Orderbook<SwissTable>>>("map/swiss", 64));
+        books.push_back(std::make_unique<Checked<Vector_Orderbook<SwissTable>>>("vector/swiss", 64));
+        books.push_back(std::make_unique<Checked<Ladder_Orderbook<SwissTable>>>("ladder/swiss", tick, 64));
+
+        StreamGenerator generator(seed, tick);
+        std::vector<BookView> views(books.size());
+        for (size_t step = 0; step < steps; ++step) {
+            const message msg = generator.next();
+            bool agree = true;
+            for (size_t b = 0; b < books.size(); ++b) {
+                books[b]->process_msg(msg);
+                views[b] = books[b]->view();
+                agree = agree && views[b] == views[0];
+            }
+            if (agree) continue;
+
+            std::cerr << "books disagree at message " << step << ": " << msg.action_ << " id " << msg.id_
+                      << " side " << msg.side_ << " price " << msg.price_ << " size " << msg.size_ << "\n";
+            for (size_t b = 0; b < books.size(); ++b) print_view(books[b]->name(), views[b]);
+            return 1;
+        }
+        std::cout << steps << " messages, all " << books.size() << " books agree, " << views[0].count_
+                  << " orders resting\n";
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,55 @@
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../parser.cpp"
+#include "../message_file.h"
+#include "../compressed_file.h"
+#include "../platform.h"
+
+// parses a csv once and writes it out as a binary message file (message_file.h) that vector_ob can
+// replay by mapping it, the symbol defaults to the input file's name without its extension. --compress
+// writes the block compressed format (compressed_file.h) instead
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> args;
+    bool compress = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--compress") compress = true;
+        else args.push_back(arg);
+    }
+
+    if (args.size() != 2 && args.size() != 3) {
+        std::cerr << "Usage: " << argv[0] << " <input_csv> <output_file> [symbol] [--compress]\n";
+        return 1;
+    }
+
+    const std::string input = args[0];
+    const std::string output = args[1];
+    const std::string symbol = args.size() == 3 ? args[2] : std::filesystem::path(input).stem().string();
+
+    try {
+        platform::Stopwatch timer;
+        Parser parser(input);
+        parser.parse();
+        uint64_t parse_ms = timer.elapsed_ms();
+
+        timer.reset();
+        if (compress) {
+            write_compressed_file(output, MessageSpan(parser.message_stream_), symbol);
+        } else {
+            write_message_file(output, MessageSpan(parser.message_stream_), symbol);
+        }
+        uint64_t write_ms = timer.elapsed_ms();
+
+        std::cout << "Wrote " << parser.get_message_count() << " messages for " << symbol << " to " << output
+                  << " (parse " << parse_ms << "ms, write " << write_ms << "ms, "
+                  << std::filesystem::file_size(output) << " bytes)\n";
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../shm_feed.h"
+#include "../platform.h"
+
+// tails the shared memory feed vector_ob publishes with --publish=<name> (shm_feed.h) from another
+// process. waits for the segment to show up, joins at the live end and reads until the publisher says
+// it's done, then reports how many top and level updates it got, how many it lost to being lapped, and
+// the publish to read latency (reader's now_ns() minus the publisher's stamp) percentiles. --print dumps
+// every update as it arrives, which makes the latency numbers meaningless. pass cpu to pin the reader,
+// ideally to a core the publisher isn't on
+
+static constexpr size_t MAX_LATENCY_SAMPLES = 1 << 22;
+// stop if the feed has been quiet this long, in case the publisher died without finishing
+static constexpr uint64_t IDLE_TIMEOUT_NS = 10ULL * 1000000000ULL;
+
+static void print_update(const FeedUpdate& update) {
+    if (update.kind_ == FeedKind::top) {
+        std::cout << update.time_ << " top " << update.bid_.volume_ << " @ " << update.bid_.price_ << " / "
+                  << update.ask_.volume_ << " @ " << update.ask_.price_ << "\n";
+    }
+    else if (update.kind_ == FeedKind::level) {
+        const BookLevel& level = update.level();
+        std::cout << update.time_ << " " << (update.is_bid_ ? "bid " : "ask ") << level.price_ << " "
+                  << level.volume_ << " (" << level.orders_ << " orders)\n";
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> args;
+    bool print = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--print") print = true;
+        else args.push_back(arg);
+    }
+
+    if (args.empty() || args.size() > 2) {
+        std::cerr << "Usage: " << argv[0] << " <shm_name> [cpu] [--print]\n";
+        return 1;
+    }
+    const std::string name = args[0];
+    const int cpu = args.size() == 2 ? std::stoi(args[1]) : -1;
+
+    try {
+        if (!FeedReader::exists(name)) {
+            std::cout << "Waiting for " << name << "\n";
+            while (!FeedReader::exists(name)) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        FeedReader reader(name);
+        std::cout << "Reading " << name << ", " << reader.capacity() << " slots, "
+                  << (reader.depth() ? std::to_string(reader.depth()) + " levels a side" : "top of book only") << "\n";
+        if (!platform::pin_thread(cpu)) std::cout << "warning: could not pin to cpu " << cpu << "\n";
+
+        std::vector<uint64_t> latencies;
+        latencies.reserve(MAX_LATENCY_SAMPLES);
+        uint64_t tops = 0;
+        uint64_t levels = 0;
+        uint64_t overruns = 0;
+        uint64_t max_latency = 0;
+        uint64_t spins = 0;
+        uint64_t last_read = platform::now_ns();
+        bool finished = false;
+
+        FeedUpdate update;
+        while (true) {
+            FeedReader::Result result = reader.try_read(update);
+            if (result == FeedReader::Result::ok) {
+                const uint64_t latency = platform::now_ns() - update.publish_ns_;
+                if (update.kind_ == FeedKind::end) {
+                    finished = true;
+                    break;
+                }
+                last_read = update.publish_ns_ + latency;
+                tops += update.kind_ == FeedKind::top;
+                levels += update.kind_ == FeedKind::level;
+                max_latency = std::max(max_latency, latency);
+                if (latencies.size() < MAX_LATENCY_SAMPLES) latencies.push_back(latency);
+                if (print) print_update(update);
+                spins = 0;
+                continue;
+            }
+            if (result == FeedReader::Result::overrun) {
+                ++overruns;
+                continue;
+            }
+            // nothing new, spin but give the core up now and then in case the publisher shares it
+            if (++spins % 1024 == 0) {
+                if (platform::now_ns() - last_read > IDLE_TIMEOUT_NS) break;
+                std::this_thread::yield();
+            }
+            else {
+                platform::cpu_relax();
+            }
+        }
+
+        if (!finished) std::cout << "Feed went quiet for " << IDLE_TIMEOUT_NS / 1000000000ULL << "s, stopping\n";
+        std::cout << "Read " << tops + levels << " updates (" << tops << " top, " << levels << " level), lost "
+                  << reader.lost() << " in " << overruns << " overruns\n";
+        if (!latencies.empty()) {
+            std::sort(latencies.begin(), latencies.end());
+            auto percentile = [&latencies](double p) {
+                return latencies[static_cast<size_t>(p * (latencies.size() - 1))] / 1000.0;
+            };
+            std::cout << std::fixed << std::setprecision(2) << "Publish to read latency us: p50 " << percentile(0.5)
+                      << ", p90 " << percentile(0.9) << ", p99 " << percentile(0.99) << ", p99.9 "
+                      << percentile(0.999) << ", max " << max_latency / 1000.0 << "\n";
+            std::cout.unsetf(std::ios::fixed);
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,161 @@
+#ifndef VECTOR_OB_TOP_OF_BOOK_H
+#define VECTOR_OB_TOP_OF_BOOK_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include "book_level.h"
+#include "platform.h"
+
+// single writer seqlock. the writer bumps version_ to odd, writes the value, bumps it to even. a reader
+// copies the value between two reads of version_ and keeps the copy only if both were the same even
+// number, so it never blocks the writer and never sees half an update. the value is held as relaxed
+// atomic words so the racing copy is well defined, on x86 and arm64 they're plain loads and stores
+template<typename T>
+class Seqlock {
+private:
+    static_assert(std::is_trivially_copyable<T>::value, "seqlock values are copied word by word");
+    static constexpr size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    alignas(64) std::atomic<uint64_t> version_{0};
+    std::atomic<uint64_t> words_[WORDS];
+
+public:
+    Seqlock() {
+        for (auto& word : words_) word.store(0, std::memory_order_relaxed);
+    }
+
+    Seqlock(const Seqlock&) = delete;
+    Seqlock& operator=(const Seqlock&) = delete;
+
+    // writer side, only ever called from one thread
+    __attribute__((always_inline))
+    void store(const T& value) {
+        uint64_t buffer[WORDS] = {};
+        std::memcpy(buffer, &value, sizeof(T));
+
+        const uint64_t version = version_.load(std::memory_order_relaxed);
+        version_.store(version + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < WORDS; ++i) {
+            words_[i].store(buffer[i], std::memory_order_relaxed);
+        }
+        version_.store(version + 2, std::memory_order_release);
+    }
+
+    // reader side, false if a write was in progress or landed during the copy. version gets the even
+    // version the copy was taken at, it goes up by 2 per store
+    __attribute__((always_inline))
+    bool try_load(T& out, uint64_t& version) const {
+        const uint64_t before = version_.load(std::memory_order_acquire);
+        if (before & 1) return false;
+
+        uint64_t buffer[WORDS];
+        for (size_t i = 0; i < WORDS; ++i) {
+            buffer[i] = words_[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (version_.load(std::memory_order_relaxed) != before) return false;
+
+        std::memcpy(&out, buffer, sizeof(T));
+        version = before;
+        return true;
+    }
+
+    // spins until it gets a consistent copy
+    T load() const {
+        T out;
+        uint64_t version;
+        while (!try_load(out, version)) platform::cpu_relax();
+        return out;
+    }
+
+    uint64_t version() const { return version_.load(std::memory_order_acquire); }
+};
+
+// what readers see, the best Depth levels a side (Depth = 1 is plain top of book)
+template<size_t Depth>
+struct BookSnapshot {
+    // exchange time of the message that produced this snapshot
+    uint64_t time_;
+    // messages the writer had processed when it published
+    uint64_t sequence_;
+    // platform::cycles() at publish, readers use it to see how old their copy is
+    uint64_t publish_cycles_;
+    uint32_t bid_levels_;
+    uint32_t ask_levels_;
+    BookLevel bids_[Depth];
+    BookLevel asks_[Depth];
+
+    bool has_bid() const { return bid_levels_ != 0; }
+    bool has_ask() const { return ask_levels_ != 0; }
+    int32_t best_bid_price() const { return bids_[0].price_; }
+    int32_t best_ask_price() const { return asks_[0].price_; }
+    uint64_t best_bid_volume() const { return bids_[0].volume_; }
+    uint64_t best_ask_volume() const { return asks_[0].volume_; }
+};
+
+// wraps a book for replay and publishes its top Depth levels through a Seqlock after every
+// process_msg. the writer keeps its own copy of the last snapshot and only stores when the levels
+// actually changed, so messages deep in the book don't touch the shared cache lines readers spin on.
+// Book is any book with get_top_levels<Side>(out, n)
+template<typename Book, size_t Depth = 1>
+class PublishedBook {
+public:
+    using Snapshot = BookSnapshot<Depth>;
+
+    explicit PublishedBook(Book& book) : book_(book) {}
+
+    template<typename Msg>
+    __attribute__((always_inline))
+    void process_msg(const Msg& msg) {
+        book_.process_msg(msg);
+        ++processed_;
+        publish(msg.time());
+    }
+
+    // readers on other threads call try_load()/load() on this
+    const Seqlock<Snapshot>& snapshot() const { return snapshot_; }
+
+    Book& book() { return book_; }
+    uint64_t processed() const { return processed_; }
+    uint64_t published() const { return published_; }
+
+private:
+    Book& book_;
+    Seqlock<Snapshot> snapshot_;
+    Snapshot last_{};
+    uint64_t processed_ = 0;
+    uint64_t published_ = 0;
+
+    __attribute__((always_inline))
+    void publish(uint64_t time) {
+        BookLevel bids[Depth];
+        BookLevel asks[Depth];
+        const auto bid_levels = static_cast<uint32_t>(book_.template get_top_levels<true>(bids, Depth));
+        const auto ask_levels = static_cast<uint32_t>(book_.template get_top_levels<false>(asks, Depth));
+
+        if (bid_levels == last_.bid_levels_ && ask_levels == last_.ask_levels_
+            && std::equal(bids, bids + bid_levels, last_.bids_) && std::equal(asks, asks + ask_levels, last_.asks_)) {
+            return;
+        }
+
+        std::copy(bids, bids + bid_levels, last_.bids_);
+        std::copy(asks, asks + ask_levels, last_.asks_);
+        // levels past the end are zeroed so readers never see a stale one
+        std::fill(last_.bids_ + bid_levels, last_.bids_ + Depth, BookLevel{});
+        std::fill(last_.asks_ + ask_levels, last_.asks_ + Depth, BookLevel{});
+        last_.bid_levels_ = bid_levels;
+        last_.ask_levels_ = ask_levels;
+        last_.time_ = time;
+        last_.sequence_ = processed_;
+        last_.publish_cycles_ = platform::cycles();
+        snapshot_.store(last_);
+        ++published_;
+    }
+};
+
+#endif //VECTOR_OB_TOP_OF_BOOK_H
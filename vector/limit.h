@@ -1,6 +1,8 @@
 #pragma once
 #include "order.h"
 #include <vector>
+#include <algorithm>
+#include <stdexcept>
 
 class Vector_Limit {
 public:
@@ -35,6 +37,14 @@ public:
 
 
 
+    // clears the level for reuse, orders_ keeps its capacity
+    __attribute__((always_inline))
+    void reset() {
+        volume_ = 0;
+        num_orders_ = 0;
+        orders_.clear();
+    }
+
     __attribute__((always_inline))
     bool is_empty() const { return num_orders_ == 0; }
 
@@ -1,41 +1,24 @@
 #pragma once
-#include <vector>
 #include "order.h"
+#include "../slab_pool.h"
 
 
 class OrderPool {
 private:
-    std::vector<std::unique_ptr<Order>> pool_;
-    std::vector<Order*> available_orders_;
+    SlabPool<Order> pool_;
 
 public:
-    explicit OrderPool(size_t initial_size) {
-        pool_.reserve(initial_size);
-        available_orders_.reserve(initial_size);
-        for (size_t i = 0; i < initial_size; ++i) {
-            pool_.push_back(std::make_unique<Order>());
-            available_orders_.push_back(pool_.back().get());
-        }
-    }
+    explicit OrderPool(size_t initial_size, bool huge_pages = true) : pool_(initial_size, huge_pages) {}
 
-    //~OrderPool();
     __attribute__((always_inline))
-    Order* get_order() {
-        if (available_orders_.empty()) {
-            pool_.push_back(std::make_unique<Order>());
-            return pool_.back().get();
-        }
-        Order* order = available_orders_.back();
-        available_orders_.pop_back();
-        return order;
-    }
+    Order* get_order() { return pool_.allocate(); }
 
     __attribute__((always_inline))
-    void return_order(Order* order) { available_orders_.push_back(order); }
+    void return_order(Order* order) { pool_.deallocate(order); }
 
     __attribute__((always_inline))
-    inline void reset() {
-        pool_.clear();
-        pool_.reserve(1000000);
-    }
+    inline void reset() { pool_.reset(); }
+
+    size_t live() const { return pool_.live(); }
+    size_t capacity() const { return pool_.capacity(); }
 };
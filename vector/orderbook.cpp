@@ -1,9 +1,15 @@
 #include <vector>
 #include "limit.h"
 #include "../lookup_table.h"
+#include "../swiss_table.h"
+#include "../direct_index_table.h"
 #include "order_pool.h"
+#include "../limit_pool.h"
 #include "../message.h"
+#include "../book_level.h"
 
+// both sides keep their best level at the back of the vector (bids ascending, offers descending),
+// so inserting or erasing a level near the touch only shifts the handful of levels behind it
 template<bool Side>
 struct BookSide {};
 
@@ -23,15 +29,19 @@ struct BookSide<false> {
     };
 };
 
+// OrderTable is the order id -> Order* index, OpenAddressTable, SwissTable or DirectIndexTable
+template<template<typename> class OrderTable = OpenAddressTable>
 class Vector_Orderbook {
 private:
     BookSide<true>::MapType bids_;
     BookSide<false>::MapType offers_;
-    OpenAddressTable<Order> order_lookup_;
+    OrderTable<Order> order_lookup_;
     OrderPool order_pool_;
+    LimitPool<Vector_Limit> limit_pool_;
 
     static constexpr size_t INITIAL_LEVELS = 1000;
     static constexpr size_t INITIAL_ORDERS = 1000000;
+    static constexpr size_t TOUCH_SCAN_LEVELS = 8;
 
     template<bool Side>
     typename BookSide<Side>::MapType& get_book_side() {
@@ -41,24 +51,59 @@ private:
         else return offers_;
     }
 
+    // same result as std::lower_bound over the whole side, but walks in from the back first since
+    // most prices we see are within a few levels of the touch, only binary searching if we run out
+    template<bool Side>
+    __attribute__((always_inline))
+    typename BookSide<Side>::MapType::iterator find_level(int32_t price) {
+        auto& levels = get_book_side<Side>();
+        auto first = levels.begin();
+        auto it = levels.end();
+
+        for (size_t i = 0; i < TOUCH_SCAN_LEVELS; ++i) {
+            if (it == first || BookSide<Side>::compare(*(it - 1), price)) {
+                return it;
+            }
+            --it;
+        }
+        return std::lower_bound(first, it, price, BookSide<Side>::compare);
+    }
+
+    // parent just lost its last order. the level is looked up by the order's own price and side and only
+    // erased if it's parent, so a cancel with the wrong price or side can't take out a live level and
+    // hand its limit back to the pool
+    template<bool Side>
+    __attribute__((always_inline))
+    void erase_level(Vector_Limit* parent, int32_t price) {
+        auto& levels = get_book_side<Side>();
+        auto it = find_level<Side>(price);
+
+        if (it != levels.end() && it->first == price && it->second == parent) {
+            levels.erase(it);
+            limit_pool_.return_limit(parent);
+        }
+    }
+
 public:
-    Vector_Orderbook() : order_pool_(INITIAL_ORDERS) {
-        bids_.reserve(INITIAL_LEVELS);
-        offers_.reserve(INITIAL_LEVELS);
-        order_lookup_.reserve(INITIAL_ORDERS);
+    // the defaults size a book for a single busy instrument, BookManager builds smaller ones
+    explicit Vector_Orderbook(size_t initial_orders = INITIAL_ORDERS, size_t initial_levels = INITIAL_LEVELS)
+            : order_pool_(initial_orders), limit_pool_(initial_levels) {
+        bids_.reserve(initial_levels);
+        offers_.reserve(initial_levels);
+        order_lookup_.reserve(initial_orders);
     }
 
     template<bool Side>
     __attribute__((always_inline))
     Vector_Limit* find_or_insert_limit(int32_t price) {
         auto& levels = get_book_side<Side>();
-        auto it = std::lower_bound(levels.begin(), levels.end(), price, BookSide<Side>::compare);
+        auto it = find_level<Side>(price);
 
         if (it != levels.end() && it->first == price) {
             return it->second;
         }
 
-        auto* limit = new Vector_Limit();
+        auto* limit = limit_pool_.get_limit();
         levels.emplace(it, price, limit);
         return limit;
     }
@@ -82,18 +127,16 @@ public:
     template<bool Side>
     __attribute__((always_inline))
     void remove_order(uint64_t order_id, int32_t order_price, int32_t order_size) {
-        auto target = *order_lookup_.find(order_id);
+        auto** target_ptr = order_lookup_.find(order_id);
+        if (!target_ptr) return;
+
+        auto target = *target_ptr;
         auto parent_limit = target->parent_;
         parent_limit->remove_order(target);
 
         if (parent_limit->num_orders_ == 0) {
-            auto& levels = get_book_side<Side>();
-            auto it = std::lower_bound(levels.begin(), levels.end(), order_price,
-                                       BookSide<Side>::compare);
-
-            if (it->first == order_price) {
-                levels.erase(it);
-            }
+            if (target->side_) erase_level<true>(parent_limit, target->price_);
+            else erase_level<false>(parent_limit, target->price_);
         }
 
         order_lookup_.erase(order_id);
@@ -103,14 +146,19 @@ public:
     template<bool Side>
     __attribute__((always_inline))
     void modify_order(uint64_t order_id, int32_t new_price, int32_t new_size, uint64_t order_time) {
-        auto* target = *order_lookup_.find(order_id);
-        if (!target) {
+        auto** target_ptr = order_lookup_.find(order_id);
+        if (!target_ptr) {
             add_order<Side>(order_id, new_price, new_size, order_time);
             return;
         }
 
+        auto* target = *target_ptr;
+
+        // a side change is a cancel plus an add, remove_order takes the order off the side it rests on
         if (target->side_ != Side) {
-            throw std::runtime_error("Order changed sides");
+            remove_order<Side>(order_id, target->price_, target->size_);
+            add_order<Side>(order_id, new_price, new_size, order_time);
+            return;
         }
 
         auto old_price = target->price_;
@@ -128,45 +176,104 @@ public:
             return;
         }
 
+        target->parent_->volume_ -= old_size - new_size;
         target->size_ = new_size;
         target->unix_time_ = order_time;
     }
 
+    template<bool Side>
+    __attribute__((always_inline))
+    void fill_order(uint64_t order_id, uint32_t fill_size) {
+        auto** target_ptr = order_lookup_.find(order_id);
+        if (!target_ptr) return;
+
+        auto* target = *target_ptr;
+        if (fill_size >= target->size_) {
+            remove_order<Side>(order_id, target->price_, target->size_);
+            return;
+        }
+        target->size_ -= fill_size;
+        target->parent_->volume_ -= fill_size;
+    }
+
+    // empties the book in one go, the pools take every order and level back at once instead of one
+    // remove_order at a time, and the level vectors and order table keep their capacity for the refill
+    void clear() {
+        bids_.clear();
+        offers_.clear();
+        order_lookup_.clear();
+        order_pool_.reset();
+        limit_pool_.reset();
+    }
 
+    // Msg is message or PackedMessageView (packed_message.h), anything with the same accessors
+    template<typename Msg>
     __attribute__((always_inline))
-    inline void process_msg(const message& msg) {
-        switch (msg.action_) {
+    inline void process_msg(const Msg& msg) {
+        switch (msg.action()) {
             case 'A':
-                if (msg.side_) {
-                    add_order<true>(msg.id_, msg.price_, msg.size_, msg.time_);
+                if (msg.side()) {
+                    add_order<true>(msg.id(), msg.price(), msg.size(), msg.time());
                 } else {
-                    add_order<false>(msg.id_, msg.price_, msg.size_, msg.time_);
+                    add_order<false>(msg.id(), msg.price(), msg.size(), msg.time());
                 }
                 break;
 
             case 'M':
-                if (msg.side_) {
-                    modify_order<true>(msg.id_, msg.price_, msg.size_, msg.time_);
+                if (msg.side()) {
+                    modify_order<true>(msg.id(), msg.price(), msg.size(), msg.time());
                 } else {
-                    modify_order<false>(msg.id_, msg.price_, msg.size_, msg.time_);
+                    modify_order<false>(msg.id(), msg.price(), msg.size(), msg.time());
                 }
                 break;
 
             case 'C':
-                if (msg.side_) {
-                    remove_order<true>(msg.id_, msg.price_, msg.size_);
+                if (msg.side()) {
+                    remove_order<true>(msg.id(), msg.price(), msg.size());
+                } else {
+                    remove_order<false>(msg.id(), msg.price(), msg.size());
+                }
+                break;
+
+            case 'F':
+                if (msg.side()) {
+                    fill_order<true>(msg.id(), msg.size());
                 } else {
-                    remove_order<false>(msg.id_, msg.price_, msg.size_);
+                    fill_order<false>(msg.id(), msg.size());
                 }
                 break;
+
+            case 'R':
+                clear();
+                break;
+
+            case 'T':
+                break;
         }
     }
 
-    int32_t get_best_bid_price() const { return bids_.rbegin()->first; }
+    int32_t get_best_bid_price() const { return bids_.back().first; }
+
+    int32_t get_best_ask_price() const { return offers_.back().first; }
+
+    uint32_t get_best_bid_volume() const { return bids_.back().second->volume_; }
+
+    uint32_t get_best_ask_volume() const { return offers_.back().second->volume_; }
+
+    // up to n levels of one side, best first, returns how many there were
+    template<bool Side>
+    size_t get_top_levels(BookLevel* out, size_t n) const {
+        const auto& levels = Side ? bids_ : offers_;
+        size_t count = 0;
+        for (auto it = levels.rbegin(); it != levels.rend() && count < n; ++it, ++count) {
+            out[count] = {it->first, it->second->num_orders_, it->second->volume_};
+        }
+        return count;
+    }
 
-    int32_t get_best_ask_price() const { return offers_.rbegin()->first; }
+    size_t get_count() const { return order_lookup_.size(); }
 
-    uint32_t get_best_bid_volume() const { return bids_.rbegin()->second->volume_; }
+    size_t get_live_levels() const { return limit_pool_.live(); }
 
-    uint32_t get_best_ask_volume() const { return offers_.rbegin()->second->volume_; }
+    size_t get_peak_levels() const { return limit_pool_.peak(); }
 };
\ No newline at end of file